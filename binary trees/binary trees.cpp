@@ -2,6 +2,7 @@
 #include <vector>
 #include <algorithm>
 #include <string>
+#include <cmath>
 
 const int WINDOW_WIDTH = 1100;
 const int WINDOW_HEIGHT = 800;
@@ -10,6 +11,76 @@ const int BUTTON_HEIGHT = 40;
 const int BUTTON_START_Y = 110;
 const int TRAVERSAL_Y = 600;
 
+// Пакетная отрисовка через вершинные массивы OpenGL 1.1: линии и круги всего дерева
+// уходят двумя вызовами glDrawArrays. Круг собирается из заранее посчитанной единичной
+// окружности, без cos/sin на каждый узел.
+class RenderBatch {
+private:
+    static const int circleSegments = 36;
+    std::vector<float> unitCircle;  // cos, sin для точек 0 .. circleSegments (последняя = первая)
+    std::vector<float> triangles;
+    std::vector<float> triangleColors;
+    std::vector<float> lines;
+    std::vector<float> lineColors;
+    float color[3];
+
+    void pushVertex(std::vector<float>& vertices, std::vector<float>& colors, float x, float y) {
+        vertices.push_back(x);
+        vertices.push_back(y);
+        colors.insert(colors.end(), color, color + 3);
+    }
+
+    static void drawArrays(GLenum mode, const std::vector<float>& vertices, const std::vector<float>& colors) {
+        if (vertices.empty()) return;
+        glVertexPointer(2, GL_FLOAT, 0, vertices.data());
+        glColorPointer(3, GL_FLOAT, 0, colors.data());
+        glDrawArrays(mode, 0, static_cast<GLsizei>(vertices.size() / 2));
+    }
+
+public:
+    RenderBatch() : unitCircle(2 * (circleSegments + 1)) {
+        for (int i = 0; i <= circleSegments; ++i) {
+            float angle = 2.0f * 3.14159265f * i / circleSegments;
+            unitCircle[2 * i] = std::cos(angle);
+            unitCircle[2 * i + 1] = std::sin(angle);
+        }
+        setColor(0.0f, 0.0f, 0.0f);
+    }
+
+    void setColor(float r, float g, float b) {
+        color[0] = r;
+        color[1] = g;
+        color[2] = b;
+    }
+
+    void addLine(float x1, float y1, float x2, float y2) {
+        pushVertex(lines, lineColors, x1, y1);
+        pushVertex(lines, lineColors, x2, y2);
+    }
+
+    void addDisc(float x, float y, float radius) {
+        for (int i = 0; i < circleSegments; ++i) {
+            pushVertex(triangles, triangleColors, x, y);
+            pushVertex(triangles, triangleColors, x + radius * unitCircle[2 * i], y + radius * unitCircle[2 * i + 1]);
+            pushVertex(triangles, triangleColors, x + radius * unitCircle[2 * i + 2], y + radius * unitCircle[2 * i + 3]);
+        }
+    }
+
+    // Линии, затем круги поверх них; накопленное сбрасывается
+    void flush() {
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        drawArrays(GL_LINES, lines, lineColors);
+        drawArrays(GL_TRIANGLES, triangles, triangleColors);
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+        triangles.clear();
+        triangleColors.clear();
+        lines.clear();
+        lineColors.clear();
+    }
+};
+
 class BinaryTree {
 private:
     struct TreeNode {
@@ -28,6 +99,7 @@ private:
     int currentStep;
     bool isTraversing;
     int treeX, treeY;
+    RenderBatch batch;
 
     void deleteTree(TreeNode* node) {
         if (node) {
@@ -153,35 +225,26 @@ public:
         root = removeNode(root, value);
     }
 
+    // Связи и круг узла - в пакет, он рисуется одним разом в drawTree
     void drawNode(TreeNode* node) {
         if (!node) return;
 
         // Рисуем связи
+        batch.setColor(1, 1, 1);
         if (node->left) {
-            glColor3f(1, 1, 1);
-            glBegin(GL_LINES);
-            glVertex2i(node->x, node->y);
-            glVertex2i(node->left->x, node->left->y);
-            glEnd();
+            batch.addLine(node->x, node->y, node->left->x, node->left->y);
         }
         if (node->right) {
-            glColor3f(1, 1, 1);
-            glBegin(GL_LINES);
-            glVertex2i(node->x, node->y);
-            glVertex2i(node->right->x, node->right->y);
-            glEnd();
+            batch.addLine(node->x, node->y, node->right->x, node->right->y);
         }
 
         // Рисуем узел
-        if (node->isMin) glColor3f(0.0f, 1.0f, 0.0f); // Зеленый для минимального
-        else glColor3f(0.4f, 0.7f, 1.0f); // Синий для обычных
+        if (node->isMin) batch.setColor(0.0f, 1.0f, 0.0f); // Зеленый для минимального
+        else batch.setColor(0.4f, 0.7f, 1.0f); // Синий для обычных
+        batch.addDisc(node->x, node->y, 20);
+    }
 
-        glBegin(GL_POLYGON);
-        for (int i = 0; i < 360; i++) {
-            float angle = i * 3.14159f / 180;
-            glVertex2f(node->x + 20 * cos(angle), node->y + 20 * sin(angle));
-        }
-        glEnd();
+    void drawLabel(TreeNode* node) {
         // Текст
         glColor3f(0, 0, 0);
         glRasterPos2i(node->x - (node->data < 10 ? 5 : 10), node->y - 5);
@@ -193,6 +256,8 @@ public:
         if (root) {
             setPositions(root, treeX, treeY, 1);
             drawTreeNodes(root);
+            batch.flush();
+            drawTreeLabels(root);
         }
     }
 
@@ -203,6 +268,13 @@ public:
         drawTreeNodes(node->right);
     }
 
+    void drawTreeLabels(TreeNode* node) {
+        if (!node) return;
+        drawLabel(node);
+        drawTreeLabels(node->left);
+        drawTreeLabels(node->right);
+    }
+
     void startTraversal(const std::string& type) {
         traversalResult.clear();
         currentStep = 0;
@@ -1,11 +1,23 @@
-﻿#include <GL/glut.h>
+﻿#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include <GL/glut.h>
 #include <vector>
 #include <queue>
+#include <unordered_map>
 #include <algorithm>
+#include <cmath>
+#include <memory>
 #include <limits>
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 
@@ -14,6 +26,89 @@ const int WINDOW_HEIGHT = 600;
 const float NODE_RADIUS = 20.0f;
 const int INF = numeric_limits<int>::max();
 
+// Пакетная отрисовка через вершинные массивы OpenGL 1.1: примитивы кадра копятся в
+// массивах координат и цветов и уходят одним glDrawArrays на тип примитива. Круги
+// собираются из заранее посчитанной единичной окружности, без cos/sin в кадре.
+class RenderBatch {
+private:
+    static const int circleSegments = 36;
+    vector<float> unitCircle;  // cos, sin для точек 0 .. circleSegments (последняя = первая)
+    vector<float> triangles;
+    vector<float> triangleColors;
+    vector<float> lines;
+    vector<float> lineColors;
+    float color[3];
+
+    void pushVertex(vector<float>& vertices, vector<float>& colors, float x, float y) {
+        vertices.push_back(x);
+        vertices.push_back(y);
+        colors.insert(colors.end(), color, color + 3);
+    }
+
+    static void drawArrays(GLenum mode, const vector<float>& vertices, const vector<float>& colors) {
+        if (vertices.empty()) return;
+        glVertexPointer(2, GL_FLOAT, 0, vertices.data());
+        glColorPointer(3, GL_FLOAT, 0, colors.data());
+        glDrawArrays(mode, 0, static_cast<GLsizei>(vertices.size() / 2));
+    }
+
+public:
+    RenderBatch() : unitCircle(2 * (circleSegments + 1)) {
+        for (int i = 0; i <= circleSegments; ++i) {
+            float angle = 2.0f * 3.14159265f * i / circleSegments;
+            unitCircle[2 * i] = cos(angle);
+            unitCircle[2 * i + 1] = sin(angle);
+        }
+        setColor(0.0f, 0.0f, 0.0f);
+    }
+
+    void setColor(float r, float g, float b) {
+        color[0] = r;
+        color[1] = g;
+        color[2] = b;
+    }
+
+    void addLine(float x1, float y1, float x2, float y2) {
+        pushVertex(lines, lineColors, x1, y1);
+        pushVertex(lines, lineColors, x2, y2);
+    }
+
+    void addTriangle(float x1, float y1, float x2, float y2, float x3, float y3) {
+        pushVertex(triangles, triangleColors, x1, y1);
+        pushVertex(triangles, triangleColors, x2, y2);
+        pushVertex(triangles, triangleColors, x3, y3);
+    }
+
+    void addDisc(float x, float y, float radius) {
+        for (int i = 0; i < circleSegments; ++i) {
+            addTriangle(x, y,
+                x + radius * unitCircle[2 * i], y + radius * unitCircle[2 * i + 1],
+                x + radius * unitCircle[2 * i + 2], y + radius * unitCircle[2 * i + 3]);
+        }
+    }
+
+    void addCircle(float x, float y, float radius) {
+        for (int i = 0; i < circleSegments; ++i) {
+            addLine(x + radius * unitCircle[2 * i], y + radius * unitCircle[2 * i + 1],
+                x + radius * unitCircle[2 * i + 2], y + radius * unitCircle[2 * i + 3]);
+        }
+    }
+
+    // Треугольники, затем линии поверх; накопленное сбрасывается
+    void flush() {
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        drawArrays(GL_TRIANGLES, triangles, triangleColors);
+        drawArrays(GL_LINES, lines, lineColors);
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+        triangles.clear();
+        triangleColors.clear();
+        lines.clear();
+        lineColors.clear();
+    }
+};
+
 class GraphNode {
 private:
     float x, y;
@@ -21,9 +116,10 @@ private:
     bool visited;
     int distance;
     GraphNode* predecessor;
+    bool alive;
 
 public:
-    GraphNode(float x, float y, int id) : x(x), y(y), id(id), visited(false), distance(INF), predecessor(nullptr) {}
+    GraphNode(float x, float y, int id) : x(x), y(y), id(id), visited(false), distance(INF), predecessor(nullptr), alive(true) {}
 
     float getX() const { return x; }
     float getY() const { return y; }
@@ -31,24 +127,29 @@ public:
     bool isVisited() const { return visited; }
     int getDistance() const { return distance; }
     GraphNode* getPredecessor() const { return predecessor; }
+    bool isAlive() const { return alive; }
 
     void setVisited(bool v) { visited = v; }
     void setDistance(int d) { distance = d; }
     void setPredecessor(GraphNode* p) { predecessor = p; }
     void setId(int newId) { id = newId; }
+    void setAlive(bool a) { alive = a; }
 
-    void draw() const {
+    void draw(RenderBatch& batch) const {
         if (visited) {
-            glColor3f(0.0f, 1.0f, 0.0f);
+            batch.setColor(0.0f, 1.0f, 0.0f);
         }
         else {
-            glColor3f(0.0f, 0.0f, 1.0f);
+            batch.setColor(0.0f, 0.0f, 1.0f);
         }
-        drawCircle(x, y, NODE_RADIUS, true);
+        batch.addDisc(x, y, NODE_RADIUS);
 
-        glColor3f(1.0f, 1.0f, 1.0f);
-        drawCircle(x, y, NODE_RADIUS, false);
+        batch.setColor(1.0f, 1.0f, 1.0f);
+        batch.addCircle(x, y, NODE_RADIUS);
+    }
 
+    // Подписи рисуются после всех кругов пакета
+    void drawLabels() const {
         glColor3f(1.0f, 1.0f, 1.0f);
         string idText = to_string(id);
         float textWidth = idText.size() * 6.0f;
@@ -61,15 +162,6 @@ public:
     }
 
 private:
-    void drawCircle(float x, float y, float radius, bool filled) const {
-        glBegin(filled ? GL_TRIANGLE_FAN : GL_LINE_LOOP);
-        for (int i = 0; i < 360; i += 10) {
-            float angle = i * 3.14159f / 180.0f;
-            glVertex2f(x + radius * cos(angle), y + radius * sin(angle));
-        }
-        glEnd();
-    }
-
     void drawText(float x, float y, const string& text) const {
         glRasterPos2f(x, y);
         for (char c : text) {
@@ -95,34 +187,45 @@ public:
     void setWeight(int w) { weight = w; }
     void setHighlighted(bool h) { highlighted = h; }
 
-    void draw(const vector<GraphNode>& nodes, bool directedGraph, bool showWeights) const {
+    // Описанный прямоугольник отрезка задевает прямоугольник [x0, x1] x [y0, y1]
+    bool overlapsRect(const vector<GraphNode>& nodes, float x0, float y0, float x1, float y1) const {
+        float ax = nodes[from].getX(), ay = nodes[from].getY();
+        float bx = nodes[to].getX(), by = nodes[to].getY();
+        return max(ax, bx) >= x0 && min(ax, bx) <= x1 && max(ay, by) >= y0 && min(ay, by) <= y1;
+    }
+
+    void draw(RenderBatch& batch, const vector<GraphNode>& nodes, bool directedGraph) const {
         const GraphNode& fromNode = nodes[from];
         const GraphNode& toNode = nodes[to];
 
         if (highlighted) {
-            glColor3f(1.0f, 0.0f, 0.0f);
+            batch.setColor(1.0f, 0.0f, 0.0f);
         }
         else {
-            glColor3f(0.5f, 0.5f, 0.5f);
+            batch.setColor(0.5f, 0.5f, 0.5f);
         }
-
-        glBegin(GL_LINES);
-        glVertex2f(fromNode.getX(), fromNode.getY());
-        glVertex2f(toNode.getX(), toNode.getY());
-        glEnd();
-
-        if (directedGraph) {
-            float angle = atan2(toNode.getY() - fromNode.getY(), toNode.getX() - fromNode.getX());
-            float arrowX = toNode.getX() - NODE_RADIUS * cos(angle);
-            float arrowY = toNode.getY() - NODE_RADIUS * sin(angle);
-
-            glBegin(GL_TRIANGLES);
-            glVertex2f(arrowX, arrowY);
-            glVertex2f(arrowX - 10 * cos(angle + 0.3), arrowY - 10 * sin(angle + 0.3));
-            glVertex2f(arrowX - 10 * cos(angle - 0.3), arrowY - 10 * sin(angle - 0.3));
-            glEnd();
+        batch.addLine(fromNode.getX(), fromNode.getY(), toNode.getX(), toNode.getY());
+
+        float dx = toNode.getX() - fromNode.getX();
+        float dy = toNode.getY() - fromNode.getY();
+        float length = sqrt(dx * dx + dy * dy);
+        if (directedGraph && length > 0) {
+            // Стрелка у границы вершины, крылья повёрнуты на +-0.3 рад от направления ребра
+            const float c = 0.9553365f;  // cos(0.3)
+            const float s = 0.2955202f;  // sin(0.3)
+            dx /= length;
+            dy /= length;
+            float arrowX = toNode.getX() - NODE_RADIUS * dx;
+            float arrowY = toNode.getY() - NODE_RADIUS * dy;
+            batch.addTriangle(arrowX, arrowY,
+                arrowX - 10 * (dx * c - dy * s), arrowY - 10 * (dy * c + dx * s),
+                arrowX - 10 * (dx * c + dy * s), arrowY - 10 * (dy * c - dx * s));
         }
+    }
 
+    void drawLabel(const vector<GraphNode>& nodes, bool showWeights) const {
+        const GraphNode& fromNode = nodes[from];
+        const GraphNode& toNode = nodes[to];
         if (showWeights) {
             float midX = (fromNode.getX() + toNode.getX()) / 2;
             float midY = (fromNode.getY() + toNode.getY()) / 2;
@@ -139,90 +242,488 @@ private:
     }
 };
 
+// Списки смежности в сжатом виде (CSR): дуги вершины v лежат подряд в позициях
+// [rowBegin(v), rowEnd(v)) массивов targets/weights/edgeIds, внутри строки - по номерам
+// рёбер. Дуги новых рёбер копятся в буфере pending, а удалённая дуга вырезается из своей
+// строки сдвигом хвоста, и строка оставляет пустое место до следующего уплотнения. Буфер
+// вливается и пустоты убираются одним линейным проходом при чтении, причём пустоты - лишь
+// когда их набралось больше четверти массива. Так правка стоит O(степени), а не O(V + E).
+class AdjacencyCSR {
+private:
+    struct PendingArc {
+        int from, to, weight, edge;
+    };
+
+    vector<int> offsets;
+    vector<int> ends;      // конец живых дуг строки; до offsets[v + 1] - пустые места
+    vector<int> targets;
+    vector<int> weights;
+    vector<int> edgeIds;
+    vector<PendingArc> pending;
+    int holes;
+    bool valid;
+
+    void swapArcs(int a, int b) {
+        swap(targets[a], targets[b]);
+        swap(weights[a], weights[b]);
+        swap(edgeIds[a], edgeIds[b]);
+    }
+
+public:
+    AdjacencyCSR() : offsets(1, 0), holes(0), valid(true) {}
+
+    bool isValid() const { return valid; }
+    int nodeCount() const { return static_cast<int>(offsets.size()) - 1; }
+    int arcCount() const { return static_cast<int>(targets.size()) - holes; }
+    int rowBegin(int v) const { return offsets[v]; }
+    int rowEnd(int v) const { return ends[v]; }
+    int degree(int v) const { return ends[v] - offsets[v]; }
+    int target(int arc) const { return targets[arc]; }
+    int weight(int arc) const { return weights[arc]; }
+    int edge(int arc) const { return edgeIds[arc]; }
+
+    // Сборка с нуля подсчётом степеней, O(V + E). Внутри строки дуги идут по номерам рёбер.
+    // reversed - входящие дуги вместо исходящих
+    void build(int nodeCount, const vector<GraphEdge>& edges, bool directed, bool reversed = false) {
+        offsets.assign(nodeCount + 1, 0);
+        for (const auto& e : edges) {
+            ++offsets[(reversed ? e.getTo() : e.getFrom()) + 1];
+            if (!directed) ++offsets[(reversed ? e.getFrom() : e.getTo()) + 1];
+        }
+        for (int v = 0; v < nodeCount; ++v) {
+            offsets[v + 1] += offsets[v];
+        }
+        targets.resize(offsets.back());
+        weights.resize(offsets.back());
+        edgeIds.resize(offsets.back());
+        vector<int> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            const GraphEdge& e = edges[i];
+            int from = reversed ? e.getTo() : e.getFrom();
+            int to = reversed ? e.getFrom() : e.getTo();
+            int arc = cursor[from]++;
+            targets[arc] = to;
+            weights[arc] = e.getWeight();
+            edgeIds[arc] = static_cast<int>(i);
+            if (!directed) {
+                arc = cursor[to]++;
+                targets[arc] = from;
+                weights[arc] = e.getWeight();
+                edgeIds[arc] = static_cast<int>(i);
+            }
+        }
+        ends.assign(offsets.begin() + 1, offsets.end());
+        holes = 0;
+        pending.clear();
+        valid = true;
+    }
+
+    void addNode() {
+        if (!valid) return;
+        offsets.push_back(offsets.back());
+        ends.push_back(offsets.back());
+    }
+
+    void addArc(int from, int to, int weight, int edge) {
+        if (valid) pending.push_back({ from, to, weight, edge });
+    }
+
+    // Убирает одну дугу ребра edge из строки from (или из буфера): O(степени)
+    void removeArc(int from, int edge) {
+        if (!valid) return;
+        int end = ends[from];
+        for (int arc = offsets[from]; arc < end; ++arc) {
+            if (edgeIds[arc] != edge) continue;
+            move(targets.begin() + arc + 1, targets.begin() + end, targets.begin() + arc);
+            move(weights.begin() + arc + 1, weights.begin() + end, weights.begin() + arc);
+            move(edgeIds.begin() + arc + 1, edgeIds.begin() + end, edgeIds.begin() + arc);
+            --ends[from];
+            ++holes;
+            return;
+        }
+        for (auto it = pending.begin(); it != pending.end(); ++it) {
+            if (it->from == from && it->edge == edge) {
+                pending.erase(it);
+                return;
+            }
+        }
+    }
+
+    // Ребро сменило номер (перенесено на место удалённого): одна дуга строки from получает
+    // новый номер и сдвигается к своему месту по порядку номеров
+    void renumberArc(int from, int oldEdge, int newEdge) {
+        if (!valid) return;
+        for (int arc = offsets[from]; arc < ends[from]; ++arc) {
+            if (edgeIds[arc] != oldEdge) continue;
+            edgeIds[arc] = newEdge;
+            for (; arc > offsets[from] && edgeIds[arc - 1] > newEdge; --arc) swapArcs(arc - 1, arc);
+            return;
+        }
+        for (auto& arc : pending) {
+            if (arc.from == from && arc.edge == oldEdge) {
+                arc.edge = newEdge;
+                return;
+            }
+        }
+    }
+
+    // Вес меняется на месте, перестраивать ничего не нужно
+    void setWeight(int from, int edge, int weight) {
+        if (!valid) return;
+        for (int arc = offsets[from]; arc < ends[from]; ++arc) {
+            if (edgeIds[arc] == edge) weights[arc] = weight;
+        }
+        for (auto& arc : pending) {
+            if (arc.edge == edge) arc.weight = weight;
+        }
+    }
+
+    // После смены ориентированности дуги другие - проще собрать всё заново
+    void invalidate() {
+        valid = false;
+        pending.clear();
+    }
+
+    // Вливает буфер и убирает пустые места: живые дуги строк переписываются подряд, новые
+    // встают в хвост своих строк. Результат совпадает с build() по тем же рёбрам
+    void flush() {
+        if (pending.empty() && holes * 4 <= static_cast<int>(targets.size())) return;
+        int n = nodeCount();
+        vector<int> added(n, 0);
+        for (const auto& arc : pending) {
+            ++added[arc.from];
+        }
+        vector<int> packed(n + 1, 0);
+        for (int v = 0; v < n; ++v) {
+            packed[v + 1] = packed[v] + degree(v) + added[v];
+        }
+        vector<int> newTargets(packed[n]), newWeights(packed[n]), newEdgeIds(packed[n]);
+        vector<int> cursor(n);
+        for (int v = 0; v < n; ++v) {
+            copy(targets.begin() + offsets[v], targets.begin() + ends[v], newTargets.begin() + packed[v]);
+            copy(weights.begin() + offsets[v], weights.begin() + ends[v], newWeights.begin() + packed[v]);
+            copy(edgeIds.begin() + offsets[v], edgeIds.begin() + ends[v], newEdgeIds.begin() + packed[v]);
+            cursor[v] = packed[v] + degree(v);
+        }
+        targets.swap(newTargets);
+        weights.swap(newWeights);
+        edgeIds.swap(newEdgeIds);
+        for (const auto& p : pending) {
+            int arc = cursor[p.from]++;
+            targets[arc] = p.to;
+            weights[arc] = p.weight;
+            edgeIds[arc] = p.edge;
+        }
+        // Новые рёбра старше прежних, но перенумерованное могло получить меньший номер
+        for (int v = 0; v < n; ++v) {
+            if (added[v] == 0) continue;
+            for (int arc = packed[v + 1] - added[v]; arc < packed[v + 1]; ++arc) {
+                for (int k = arc; k > packed[v] && edgeIds[k - 1] > edgeIds[k]; --k) swapArcs(k - 1, k);
+            }
+        }
+        offsets.swap(packed);
+        ends.assign(offsets.begin() + 1, offsets.end());
+        holes = 0;
+        pending.clear();
+    }
+};
+
+// Равномерная сетка по координатам вершин для поиска по клику и по прямоугольнику.
+// Ячейка со стороной cellSize хранит номера своих вершин; запрос обходит только ячейки,
+// задетые областью, поэтому стоит O(1 + найденных), пока вершины не свалены в одну ячейку.
+// Пустые ячейки не хранятся, так что координаты не ограничены окном.
+class SpatialGrid {
+private:
+    float cellSize;
+    unordered_map<long long, vector<int>> cells;
+    vector<pair<float, float>> positions;  // по номеру вершины
+    vector<bool> present;
+
+    int cellCoord(float v) const { return static_cast<int>(floor(v / cellSize)); }
+
+    static long long cellKey(int cx, int cy) {
+        return static_cast<long long>(cx) << 32 | static_cast<unsigned>(cy);
+    }
+
+    // visit(id) для всех вершин из ячеек, задетых прямоугольником
+    template<typename Visit>
+    void forEachInCells(float x0, float y0, float x1, float y1, Visit visit) const {
+        int cx0 = cellCoord(x0), cx1 = cellCoord(x1);
+        int cy0 = cellCoord(y0), cy1 = cellCoord(y1);
+        // Большой прямоугольник дешевле проверить по непустым ячейкам
+        if (static_cast<long long>(cx1 - cx0 + 1) * (cy1 - cy0 + 1) > static_cast<long long>(cells.size())) {
+            for (const auto& cell : cells) {
+                for (int id : cell.second) visit(id);
+            }
+            return;
+        }
+        for (int cx = cx0; cx <= cx1; ++cx) {
+            for (int cy = cy0; cy <= cy1; ++cy) {
+                auto it = cells.find(cellKey(cx, cy));
+                if (it == cells.end()) continue;
+                for (int id : it->second) visit(id);
+            }
+        }
+    }
+
+public:
+    explicit SpatialGrid(float cellSize) : cellSize(cellSize) {}
+
+    void insert(int id, float x, float y) {
+        if (id >= static_cast<int>(positions.size())) {
+            positions.resize(id + 1);
+            present.resize(id + 1, false);
+        }
+        if (present[id]) remove(id);
+        positions[id] = make_pair(x, y);
+        present[id] = true;
+        cells[cellKey(cellCoord(x), cellCoord(y))].push_back(id);
+    }
+
+    void remove(int id) {
+        if (id < 0 || id >= static_cast<int>(present.size()) || !present[id]) return;
+        auto it = cells.find(cellKey(cellCoord(positions[id].first), cellCoord(positions[id].second)));
+        vector<int>& cell = it->second;
+        *find(cell.begin(), cell.end(), id) = cell.back();
+        cell.pop_back();
+        if (cell.empty()) cells.erase(it);
+        present[id] = false;
+    }
+
+    void clear() {
+        cells.clear();
+        positions.clear();
+        present.clear();
+    }
+
+    // Вершина с наименьшим номером не дальше radius от точки, или -1
+    int findAt(float x, float y, float radius) const {
+        int found = -1;
+        forEachInCells(x - radius, y - radius, x + radius, y + radius, [&](int id) {
+            float dx = positions[id].first - x;
+            float dy = positions[id].second - y;
+            if (dx * dx + dy * dy <= radius * radius && (found == -1 || id < found)) found = id;
+        });
+        return found;
+    }
+
+    // Вершины внутри прямоугольника (границы включаются), по возрастанию номеров
+    vector<int> queryRect(float x0, float y0, float x1, float y1) const {
+        vector<int> found;
+        forEachInCells(x0, y0, x1, y1, [&](int id) {
+            const pair<float, float>& p = positions[id];
+            if (p.first >= x0 && p.first <= x1 && p.second >= y0 && p.second <= y1) found.push_back(id);
+        });
+        sort(found.begin(), found.end());
+        return found;
+    }
+};
+
+// Номер вершины - её место в nodes, и он не меняется: удалённая вершина остаётся в
+// таблице помеченной и её номер отдаётся следующей добавленной. Рёбра удаляются
+// перестановкой последнего на место удаляемого. Ребро по концам находится через
+// хеш-индекс, рёбра вершины - по спискам incident, так что любая правка стоит
+// O(степени); списки смежности правятся на месте, а уплотняются при следующем чтении.
 class Graph {
 private:
     vector<GraphNode> nodes;
     vector<GraphEdge> edges;
-    vector<vector<int>> adjacencyMatrix;
-    int currentNodeId;
+    unordered_multimap<long long, int> edgeIndex; // концы ребра -> его номер в edges
+    vector<vector<int>> incident;                 // номера рёбер, касающихся вершины
+    vector<int> freeIds;
+    SpatialGrid spatialIndex;
+    mutable AdjacencyCSR adjacency;
+    mutable AdjacencyCSR reverseAdjacency; // входящие дуги, ведутся только для ориентированного графа
     bool directed;
 
+    // Ключ не зависит от порядка концов, если граф неориентированный
+    long long edgeKey(int from, int to) const {
+        if (!directed && from > to) swap(from, to);
+        return static_cast<long long>(from) << 32 | static_cast<unsigned>(to);
+    }
+
+    void unlinkIncident(int node, int edge) {
+        vector<int>& list = incident[node];
+        auto it = find(list.begin(), list.end(), edge);
+        *it = list.back();
+        list.pop_back();
+    }
+
+    void relinkIncident(int node, int oldEdge, int newEdge) {
+        vector<int>& list = incident[node];
+        *find(list.begin(), list.end(), oldEdge) = newEdge;
+    }
+
+    void reindexEdge(int oldEdge, int newEdge) {
+        auto range = edgeIndex.equal_range(edgeKey(edges[oldEdge].getFrom(), edges[oldEdge].getTo()));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second != oldEdge) continue;
+            if (newEdge == -1) edgeIndex.erase(it);
+            else it->second = newEdge;
+            break;
+        }
+    }
+
+    // Дуги ребра в списках смежности: у неориентированного обе лежат в adjacency
+    // (у петли - обе в одной строке), у ориентированного входящая - в reverseAdjacency
+    void removeArcs(const GraphEdge& e, int edge) {
+        adjacency.removeArc(e.getFrom(), edge);
+        if (!directed) adjacency.removeArc(e.getTo(), edge);
+        else reverseAdjacency.removeArc(e.getTo(), edge);
+    }
+
+    void renumberArcs(const GraphEdge& e, int oldEdge, int newEdge) {
+        adjacency.renumberArc(e.getFrom(), oldEdge, newEdge);
+        if (!directed) adjacency.renumberArc(e.getTo(), oldEdge, newEdge);
+        else reverseAdjacency.renumberArc(e.getTo(), oldEdge, newEdge);
+    }
+
+    void removeEdgeAt(int edge) {
+        int last = static_cast<int>(edges.size()) - 1;
+        const GraphEdge& removed = edges[edge];
+        removeArcs(removed, edge);
+        reindexEdge(edge, -1);
+        unlinkIncident(removed.getFrom(), edge);
+        if (removed.getTo() != removed.getFrom()) unlinkIncident(removed.getTo(), edge);
+
+        if (edge != last) {
+            const GraphEdge& moved = edges[last];
+            reindexEdge(last, edge);
+            renumberArcs(moved, last, edge);
+            relinkIncident(moved.getFrom(), last, edge);
+            if (moved.getTo() != moved.getFrom()) relinkIncident(moved.getTo(), last, edge);
+            edges[edge] = moved;
+        }
+        edges.pop_back();
+    }
+
 public:
-    Graph() : currentNodeId(0), directed(false) {}
+    Graph() : spatialIndex(2 * NODE_RADIUS), directed(false) {}
 
+    // В nodes есть и удалённые вершины - проверяйте isAlive()
     const vector<GraphNode>& getNodes() const { return nodes; }
     vector<GraphNode>& getNodes() { return nodes; }
     const vector<GraphEdge>& getEdges() const { return edges; }
     vector<GraphEdge>& getEdges() { return edges; }
-    const vector<vector<int>>& getAdjacencyMatrix() const { return adjacencyMatrix; }
+    const vector<int>& getIncidentEdges(int node) const { return incident[node]; }
     bool isDirected() const { return directed; }
 
-    void addNode(float x, float y) {
-        nodes.emplace_back(x, y, currentNodeId++);
+    bool isAlive(int node) const {
+        return node >= 0 && node < static_cast<int>(nodes.size()) && nodes[node].isAlive();
+    }
 
-        for (auto& row : adjacencyMatrix) {
-            row.push_back(0);
+    int getNodeCount() const { return static_cast<int>(nodes.size() - freeIds.size()); }
+
+    int firstAliveNode() const {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i].isAlive()) return static_cast<int>(i);
         }
-        adjacencyMatrix.emplace_back(nodes.size(), 0);
+        return -1;
     }
 
-    void removeNode(int nodeId) {
-        nodes.erase(remove_if(nodes.begin(), nodes.end(),
-            [nodeId](const GraphNode& n) { return n.getId() == nodeId; }), nodes.end());
+    // Вершина, в круг которой попала точка (при наложении - с меньшим номером), или -1
+    int findNodeAt(float x, float y) const {
+        return spatialIndex.findAt(x, y, NODE_RADIUS);
+    }
 
-        edges.erase(remove_if(edges.begin(), edges.end(),
-            [nodeId](const GraphEdge& e) { return e.getFrom() == nodeId  e.getTo() == nodeId; }), edges.end());
+    // Вершины с центрами в прямоугольнике - для выделения рамкой и отсечения по окну
+    vector<int> findNodesInRect(float x0, float y0, float x1, float y1) const {
+        return spatialIndex.queryRect(x0, y0, x1, y1);
+    }
 
-        if (!adjacencyMatrix.empty()) {
-            adjacencyMatrix.erase(adjacencyMatrix.begin() + nodeId);
-            for (auto& row : adjacencyMatrix) {
-                if (row.size() > static_cast<size_t>(nodeId)) {
-                    row.erase(row.begin() + nodeId);
-                }
-            }
+    // Ребро from -> to (для неориентированного - в любую сторону) с наименьшим номером, или -1
+    int findEdge(int from, int to) const {
+        int found = -1;
+        auto range = edgeIndex.equal_range(edgeKey(from, to));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (found == -1 || it->second < found) found = it->second;
         }
+        return found;
+    }
 
-        for (size_t i = 0; i < nodes.size(); ++i) {
-            nodes[i].setId(static_cast<int>(i));
+    // Актуальные списки смежности: недостающее дособирается при обращении
+    const AdjacencyCSR& getAdjacency() const {
+        if (!adjacency.isValid()) {
+            adjacency.build(static_cast<int>(nodes.size()), edges, directed);
+        }
+        else {
+            adjacency.flush();
+        }
+        return adjacency;
+    }
+
+    const AdjacencyCSR& getReverseAdjacency() const {
+        if (!directed) return getAdjacency();
+        if (!reverseAdjacency.isValid()) {
+            reverseAdjacency.build(static_cast<int>(nodes.size()), edges, directed, true);
+        }
+        else {
+            reverseAdjacency.flush();
+        }
+        return reverseAdjacency;
+    }
+
+    int addNode(float x, float y) {
+        if (!freeIds.empty()) {
+            int id = freeIds.back();
+            freeIds.pop_back();
+            nodes[id] = GraphNode(x, y, id);
+            spatialIndex.insert(id, x, y);
+            return id;
         }
-        currentNodeId = static_cast<int>(nodes.size());
+        int id = static_cast<int>(nodes.size());
+        nodes.emplace_back(x, y, id);
+        spatialIndex.insert(id, x, y);
+        incident.emplace_back();
+        adjacency.addNode();
+        reverseAdjacency.addNode();
+        return id;
+    }
+
+    void removeNode(int nodeId) {
+        if (!isAlive(nodeId)) return;
+        while (!incident[nodeId].empty()) {
+            removeEdgeAt(incident[nodeId].back());
+        }
+        nodes[nodeId].setAlive(false);
+        spatialIndex.remove(nodeId);
+        freeIds.push_back(nodeId);
     }
 
     void addEdge(int from, int to, int weight) {
-        if (from >= 0 && from < static_cast<int>(nodes.size()) &&
-            to >= 0 && to < static_cast<int>(nodes.size())) {
+        if (isAlive(from) && isAlive(to)) {
+            int edge = static_cast<int>(edges.size());
             edges.emplace_back(from, to, weight);
-            adjacencyMatrix[from][to] = weight;
+            edgeIndex.emplace(edgeKey(from, to), edge);
+            incident[from].push_back(edge);
+            if (to != from) incident[to].push_back(edge);
+            adjacency.addArc(from, to, weight, edge);
             if (!directed) {
-                adjacencyMatrix[to][from] = weight;
+                adjacency.addArc(to, from, weight, edge);
+            }
+            else {
+                reverseAdjacency.addArc(to, from, weight, edge);
             }
         }
     }
 
     void removeEdge(int from, int to) {
-        edges.erase(remove_if(edges.begin(), edges.end(),
-            [from, to, this](const GraphEdge& e) {
-                return (e.getFrom() == from && e.getTo() == to)
-                    (!this->directed && e.getFrom() == to && e.getTo() == from);
-            }), edges.end());
-
-        adjacencyMatrix[from][to] = 0;
-        if (!directed) {
-            adjacencyMatrix[to][from] = 0;
+        for (int edge = findEdge(from, to); edge != -1; edge = findEdge(from, to)) {
+            removeEdgeAt(edge);
         }
     }
-    void updateEdgeWeight(int from, int to, int newWeight) {
-        for (auto& edge : edges) {
-            if ((edge.getFrom() == from && edge.getTo() == to)
-                (!directed && edge.getFrom() == to && edge.getTo() == from)) {
-                edge.setWeight(newWeight);
-                break;
-            }
-        }
 
-        adjacencyMatrix[from][to] = newWeight;
+    void updateEdgeWeight(int from, int to, int newWeight) {
+        int i = findEdge(from, to);
+        if (i == -1) return;
+        GraphEdge& edge = edges[i];
+        edge.setWeight(newWeight);
+        adjacency.setWeight(edge.getFrom(), i, newWeight);
         if (!directed) {
-            adjacencyMatrix[to][from] = newWeight;
+            adjacency.setWeight(edge.getTo(), i, newWeight);
+        }
+        else {
+            reverseAdjacency.setWeight(edge.getTo(), i, newWeight);
         }
     }
 
@@ -238,8 +739,25 @@ public:
         return minWeight;
     }
 
+    int findMaxWeight() const {
+        int maxWeight = 0;
+        for (const auto& edge : edges) {
+            if (edge.getWeight() > maxWeight) {
+                maxWeight = edge.getWeight();
+            }
+        }
+        return maxWeight;
+    }
+
+    // Ключи неориентированных рёбер не зависят от направления - индекс пересобирается
     void toggleDirected() {
         directed = !directed;
+        edgeIndex.clear();
+        for (size_t i = 0; i < edges.size(); ++i) {
+            edgeIndex.emplace(edgeKey(edges[i].getFrom(), edges[i].getTo()), static_cast<int>(i));
+        }
+        adjacency.invalidate();
+        reverseAdjacency.invalidate();
     }
 
     void resetAlgorithmState() {
@@ -254,14 +772,691 @@ public:
     }
 };
 
+// Параллельный цикл: тела body(0) .. body(count - 1) разбираются потоками по счётчику
+template<typename Body>
+void parallelFor(int count, int threads, Body body) {
+    threads = min(threads, count);
+    if (threads <= 1) {
+        for (int i = 0; i < count; ++i) body(i);
+        return;
+    }
+    atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next++; i < count; i = next++) body(i);
+    };
+    vector<thread> pool;
+    for (int t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+// Пошаговый алгоритм на графе. step() выполняет ровно один шаг и сразу переносит его
+// результат в вершины и рёбра графа; runToEnd() доигрывает без этого и обновляет граф
+// один раз в конце. Списки смежности строятся при запуске, поэтому шаг стоит O(степени),
+// а граф во время работы алгоритма меняться не должен (кроме весов рёбер).
+class GraphAlgorithm {
+protected:
+    Graph& graph;
+    int start;
+    int n;
+    const AdjacencyCSR& adjacency;
+    vector<bool> visited;
+    vector<int> distance;
+    vector<int> predecessor;
+    vector<int> predecessorEdge;
+    string info;
+
+    void publishNode(int v) {
+        GraphNode& node = graph.getNodes()[v];
+        node.setVisited(visited[v]);
+        node.setDistance(distance[v]);
+        node.setPredecessor(predecessor[v] == -1 ? nullptr : &graph.getNodes()[predecessor[v]]);
+    }
+
+    // Вершина вошла в дерево обхода: подсвечиваем ребро, по которому в неё пришли
+    void publishVisit(int v) {
+        publishNode(v);
+        if (predecessorEdge[v] != -1) graph.getEdges()[predecessorEdge[v]].setHighlighted(true);
+    }
+
+    void publishAll() {
+        for (auto& edge : graph.getEdges()) {
+            edge.setHighlighted(false);
+        }
+        for (int v = 0; v < n; ++v) {
+            publishNode(v);
+            if (visited[v] && predecessorEdge[v] != -1) graph.getEdges()[predecessorEdge[v]].setHighlighted(true);
+        }
+    }
+
+    // Один шаг; publish - переносить ли результат шага в граф. false - шагов больше нет
+    virtual bool advance(bool publish) = 0;
+
+public:
+    GraphAlgorithm(Graph& graph, int start)
+        : graph(graph), start(start), n(static_cast<int>(graph.getNodes().size())),
+        adjacency(graph.getAdjacency()), visited(n, false), distance(n, INF), predecessor(n, -1), predecessorEdge(n, -1) {
+        graph.resetAlgorithmState();
+    }
+
+    virtual ~GraphAlgorithm() {}
+
+    bool step() {
+        bool more = advance(true);
+        if (!more) publishAll();
+        return more;
+    }
+
+    void runToEnd() {
+        while (advance(false)) {}
+        publishAll();
+    }
+
+    const string& getInfo() const { return info; }
+};
+
+// BFS с переключением направления (Beamer). Пока у фронта мало дуг, соседи фронта
+// просматриваются сверху вниз; когда дуг фронта больше, чем дуг непосещённых вершин
+// / alpha, каждая непосещённая вершина сама ищет родителя во фронте по входящим дугам
+// и останавливается на первом найденном (снизу вверх). Обратно - когда во фронте
+// меньше n / beta вершин. Фронты и посещённость - битовые маски из атомарных слов,
+// уровень обрабатывается параллельно блоками слов.
+class DirectionOptimizingBFS {
+public:
+    static const int alpha = 14;
+    static const int beta = 24;
+
+private:
+    typedef unsigned long long Word;
+    static const int wordBits = 64;
+    static const int blockWords = 64; // слов на одну задачу потока
+
+    const AdjacencyCSR& out;
+    const AdjacencyCSR& in;
+    int n;
+    int words;
+    vector<atomic<Word>> frontier;
+    vector<atomic<Word>> next;
+    vector<atomic<Word>> visited;
+    vector<int> level;
+    vector<int> parent;
+    vector<int> parentEdge;
+    int depth;                // уровень текущего фронта
+    long long frontierSize;
+    long long frontierArcs;   // исходящие дуги фронта
+    long long unvisitedArcs;  // исходящие дуги ещё не посещённых вершин
+    bool bottomUp;
+    int threads;
+
+    static void clear(vector<atomic<Word>>& bits) {
+        for (auto& word : bits) word.store(0, memory_order_relaxed);
+    }
+
+    bool test(const vector<atomic<Word>>& bits, int v) const {
+        return (bits[v / wordBits].load(memory_order_relaxed) >> (v % wordBits)) & 1;
+    }
+
+    // Захват вершины: true только у того потока, который первым поставил бит
+    bool claim(int v) {
+        Word bit = Word(1) << (v % wordBits);
+        return !(visited[v / wordBits].fetch_or(bit, memory_order_relaxed) & bit);
+    }
+
+    void discover(int v, int from, int edge, long long& count, long long& arcs) {
+        level[v] = depth + 1;
+        parent[v] = from;
+        parentEdge[v] = edge;
+        next[v / wordBits].fetch_or(Word(1) << (v % wordBits), memory_order_relaxed);
+        ++count;
+        arcs += out.degree(v);
+    }
+
+    void topDownBlock(int w0, int w1, long long& count, long long& arcs) {
+        for (int w = w0; w < w1; ++w) {
+            Word bits = frontier[w].load(memory_order_relaxed);
+            while (bits) {
+                int b = 0;
+                while (!((bits >> b) & 1)) ++b;
+                bits &= bits - 1;
+                int u = w * wordBits + b;
+                for (int arc = out.rowBegin(u); arc < out.rowEnd(u); ++arc) {
+                    int v = out.target(arc);
+                    if (test(visited, v) || !claim(v)) continue;
+                    discover(v, u, out.edge(arc), count, arcs);
+                }
+            }
+        }
+    }
+
+    void bottomUpBlock(int w0, int w1, long long& count, long long& arcs) {
+        for (int w = w0; w < w1; ++w) {
+            int first = w * wordBits;
+            int last = min(first + wordBits, n);
+            Word seen = visited[w].load(memory_order_relaxed);
+            for (int v = first; v < last; ++v) {
+                if ((seen >> (v - first)) & 1) continue;
+                for (int arc = in.rowBegin(v); arc < in.rowEnd(v); ++arc) {
+                    if (!test(frontier, in.target(arc))) continue;
+                    claim(v);
+                    discover(v, in.target(arc), in.edge(arc), count, arcs);
+                    break;
+                }
+            }
+        }
+    }
+
+public:
+    // in - входящие дуги; для неориентированного графа это те же out
+    DirectionOptimizingBFS(const AdjacencyCSR& out, const AdjacencyCSR& in, int start)
+        : out(out), in(in), n(out.nodeCount()), words((n + wordBits - 1) / wordBits),
+        frontier(words), next(words), visited(words), level(n, -1), parent(n, -1), parentEdge(n, -1),
+        depth(0), frontierSize(1), frontierArcs(out.degree(start)), unvisitedArcs(out.arcCount()),
+        bottomUp(false), threads(max(1, static_cast<int>(thread::hardware_concurrency()))) {
+        clear(frontier);
+        clear(next);
+        clear(visited);
+        level[start] = 0;
+        claim(start);
+        frontier[start / wordBits].fetch_or(Word(1) << (start % wordBits), memory_order_relaxed);
+        unvisitedArcs -= frontierArcs;
+    }
+
+    // Один уровень: из текущего фронта получается следующий. false - фронт пуст
+    bool step() {
+        if (frontierSize == 0) return false;
+        if (!bottomUp && frontierArcs > unvisitedArcs / alpha) bottomUp = true;
+        else if (bottomUp && frontierSize < n / beta) bottomUp = false;
+
+        int blocks = (words + blockWords - 1) / blockWords;
+        int workers = n < (1 << 16) ? 1 : threads;
+        atomic<long long> count(0);
+        atomic<long long> arcs(0);
+        parallelFor(blocks, workers, [&](int block) {
+            long long localCount = 0;
+            long long localArcs = 0;
+            int w0 = block * blockWords;
+            int w1 = min(w0 + blockWords, words);
+            if (bottomUp) bottomUpBlock(w0, w1, localCount, localArcs);
+            else topDownBlock(w0, w1, localCount, localArcs);
+            count += localCount;
+            arcs += localArcs;
+        });
+
+        frontier.swap(next);
+        clear(next);
+        frontierSize = count;
+        frontierArcs = arcs;
+        unvisitedArcs -= frontierArcs;
+        ++depth;
+        return true;
+    }
+
+    int getDepth() const { return depth; }
+    bool isBottomUp() const { return bottomUp; }
+    long long getFrontierSize() const { return frontierSize; }
+    int getLevel(int v) const { return level[v]; }
+    int getParent(int v) const { return parent[v]; }
+    int getParentEdge(int v) const { return parentEdge[v]; }
+
+    vector<int> frontierVertices() const {
+        vector<int> vertices;
+        for (int w = 0; w < words; ++w) {
+            Word bits = frontier[w].load(memory_order_relaxed);
+            for (int b = 0; bits; ++b, bits >>= 1) {
+                if (bits & 1) vertices.push_back(w * wordBits + b);
+            }
+        }
+        return vertices;
+    }
+};
+
+// BFS по уровням: шаг - весь следующий фронт сразу
+class BFSAlgorithm : public GraphAlgorithm {
+private:
+    DirectionOptimizingBFS bfs;
+
+    void readVertex(int v) {
+        visited[v] = bfs.getLevel(v) != -1;
+        distance[v] = visited[v] ? bfs.getLevel(v) : INF;
+        predecessor[v] = bfs.getParent(v);
+        predecessorEdge[v] = bfs.getParentEdge(v);
+    }
+
+protected:
+    bool advance(bool publish) override {
+        if (!bfs.step()) {
+            for (int v = 0; v < n; ++v) readVertex(v);
+            info = "BFS finished, depth " + to_string(bfs.getDepth() - 1);
+            return false;
+        }
+        if (publish) {
+            for (int v : bfs.frontierVertices()) {
+                readVertex(v);
+                publishVisit(v);
+            }
+            info = "BFS: level " + to_string(bfs.getDepth()) + ", " + to_string(bfs.getFrontierSize()) + " nodes"
+                + (bfs.isBottomUp() ? " (bottom-up)" : " (top-down)");
+        }
+        return true;
+    }
+
+public:
+    BFSAlgorithm(Graph& graph, int start)
+        : GraphAlgorithm(graph, start), bfs(adjacency, graph.getReverseAdjacency(), start) {
+        readVertex(start);
+        publishVisit(start);
+        info = "BFS started from " + to_string(start) + " - SPACE: step, R: run to end";
+    }
+};
+
+class DFSAlgorithm : public GraphAlgorithm {
+private:
+    vector<pair<int, int>> stack; // (вершина, следующая просматриваемая дуга)
+
+protected:
+    // Шаг: спуститься в следующую непосещённую вершину, возвращаясь из исчерпанных
+    bool advance(bool publish) override {
+        while (!stack.empty()) {
+            int u = stack.back().first;
+            int& next = stack.back().second;
+            while (next < adjacency.rowEnd(u) && visited[adjacency.target(next)]) ++next;
+            if (next == adjacency.rowEnd(u)) {
+                stack.pop_back();
+                continue;
+            }
+            int v = adjacency.target(next);
+            int edge = adjacency.edge(next);
+            ++next;
+            visited[v] = true;
+            distance[v] = distance[u] + 1;
+            predecessor[v] = u;
+            predecessorEdge[v] = edge;
+            stack.emplace_back(v, adjacency.rowBegin(v));
+            if (publish) {
+                publishVisit(v);
+                info = "DFS: visited " + to_string(v) + ", depth " + to_string(distance[v]);
+            }
+            return true;
+        }
+        info = "DFS finished";
+        return false;
+    }
+
+public:
+    DFSAlgorithm(Graph& graph, int start) : GraphAlgorithm(graph, start) {
+        visited[start] = true;
+        distance[start] = 0;
+        stack.emplace_back(start, adjacency.rowBegin(start));
+        publishVisit(start);
+        info = "DFS started from " + to_string(start) + " - SPACE: step, R: run to end";
+    }
+};
+
+// Очереди для Дейкстры. Интерфейс как у priority_queue<pair<ключ, вершина>>:
+// emplace(ключ, вершина), top(), pop(), empty().
+typedef priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> BinaryHeapQueue;
+
+// Корзины Дийала для целых весов от 0 до maxWeight. Все ключи в очереди лежат в окне
+// [текущий минимум, минимум + maxWeight], поэтому хватает maxWeight + 1 корзин по кругу.
+// Устаревшие записи не удаляются - их пропускает сам Дейкстра по флагу visited
+class BucketQueue {
+private:
+    vector<vector<int>> buckets;
+    int current;  // ключ корзины, с которой ищется минимум
+    size_t slot;  // её номер: current % buckets.size()
+    size_t count;
+
+public:
+    explicit BucketQueue(int maxWeight) : buckets(maxWeight + 1), current(0), slot(0), count(0) {}
+
+    bool empty() const { return count == 0; }
+
+    void emplace(int key, int v) {
+        buckets[(slot + (key - current)) % buckets.size()].push_back(v);
+        ++count;
+    }
+
+    pair<int, int> top() {
+        while (buckets[slot].empty()) {
+            ++current;
+            if (++slot == buckets.size()) slot = 0;
+        }
+        return make_pair(current, buckets[slot].back());
+    }
+
+    void pop() {
+        top();
+        buckets[slot].pop_back();
+        --count;
+    }
+};
+
+// Индексированная 4-арная куча с уменьшением ключа: вершина лежит в куче не больше
+// одного раза, emplace для уже лежащей вершины только уменьшает её ключ
+class IndexedHeap {
+private:
+    static const size_t arity = 4;
+    vector<pair<int, int>> heap;  // (ключ, вершина)
+    vector<int> position;         // место вершины в heap, -1 - вершины в куче нет
+
+    void place(size_t i, const pair<int, int>& item) {
+        heap[i] = item;
+        position[item.second] = static_cast<int>(i);
+    }
+
+    void siftUp(size_t i) {
+        pair<int, int> item = heap[i];
+        while (i > 0) {
+            size_t parent = (i - 1) / arity;
+            if (heap[parent].first <= item.first) break;
+            place(i, heap[parent]);
+            i = parent;
+        }
+        place(i, item);
+    }
+
+    void siftDown(size_t i) {
+        pair<int, int> item = heap[i];
+        for (;;) {
+            size_t first = i * arity + 1;
+            if (first >= heap.size()) break;
+            size_t last = min(first + arity, heap.size());
+            size_t best = first;
+            for (size_t c = first + 1; c < last; ++c) {
+                if (heap[c].first < heap[best].first) best = c;
+            }
+            if (item.first <= heap[best].first) break;
+            place(i, heap[best]);
+            i = best;
+        }
+        place(i, item);
+    }
+
+public:
+    explicit IndexedHeap(int nodeCount) : position(nodeCount, -1) {}
+
+    bool empty() const { return heap.empty(); }
+
+    void emplace(int key, int v) {
+        if (position[v] == -1) {
+            heap.emplace_back(key, v);
+            siftUp(heap.size() - 1);
+        }
+        else if (key < heap[position[v]].first) {
+            heap[position[v]].first = key;
+            siftUp(position[v]);
+        }
+    }
+
+    pair<int, int> top() const { return heap.front(); }
+
+    void pop() {
+        position[heap.front().second] = -1;
+        pair<int, int> last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            heap.front() = last;
+            siftDown(0);
+        }
+    }
+};
+
+template<typename Queue>
+class DijkstraAlgorithm : public GraphAlgorithm {
+private:
+    Queue frontier;
+    string queueName;
+
+protected:
+    // Шаг: закрепить ближайшую вершину и ослабить исходящие из неё рёбра
+    bool advance(bool publish) override {
+        while (!frontier.empty() && visited[frontier.top().second]) frontier.pop();
+        if (frontier.empty()) {
+            info = "Dijkstra (" + queueName + ") finished";
+            return false;
+        }
+        int u = frontier.top().second;
+        frontier.pop();
+        visited[u] = true;
+        for (int arc = adjacency.rowBegin(u); arc < adjacency.rowEnd(u); ++arc) {
+            int v = adjacency.target(arc);
+            int candidate = distance[u] + adjacency.weight(arc);
+            if (visited[v] || candidate >= distance[v]) continue;
+            distance[v] = candidate;
+            predecessor[v] = u;
+            predecessorEdge[v] = adjacency.edge(arc);
+            frontier.emplace(candidate, v);
+            if (publish) publishNode(v);
+        }
+        if (publish) {
+            publishVisit(u);
+            info = "Dijkstra: settled " + to_string(u) + " at distance " + to_string(distance[u]);
+        }
+        return true;
+    }
+
+public:
+    DijkstraAlgorithm(Graph& graph, int start, Queue queue, const string& queueName)
+        : GraphAlgorithm(graph, start), frontier(move(queue)), queueName(queueName) {
+        distance[start] = 0;
+        frontier.emplace(0, start);
+        publishNode(start);
+        info = "Dijkstra (" + queueName + ") started from " + to_string(start) + " - SPACE: step, R: run to end";
+    }
+
+    const vector<int>& getDistances() const { return distance; }
+};
+
+// Корзины выгоднее кучи, пока их число мало по сравнению с числом вершин
+const int BUCKET_QUEUE_MAX_WEIGHT = 1024;
+
+GraphAlgorithm* createDijkstra(Graph& graph, int start) {
+    int maxWeight = graph.findMaxWeight();
+    if (graph.findMinWeight() >= 0 && maxWeight <= BUCKET_QUEUE_MAX_WEIGHT) {
+        return new DijkstraAlgorithm<BucketQueue>(graph, start, BucketQueue(maxWeight), "buckets");
+    }
+    return new DijkstraAlgorithm<IndexedHeap>(graph, start,
+        IndexedHeap(static_cast<int>(graph.getNodes().size())), "4-ary heap");
+}
+
+// Кратчайшие пути между всеми парами: плоская матрица с выровненными строками и
+// блочный Флойд-Уоршелл. relax(k0, k1) пропускает пути через вершины [k0, k1):
+// диагональный блок, затем полосы строк и столбцов этих вершин, затем остальные
+// плитки, каждая фаза - параллельно по плиткам. Недостижимость - unreachable = INF / 2,
+// сумма двух таких значений не переполняет int, а min с ней ничего не портит.
+class AllPairsShortestPaths {
+public:
+    static const int tile = 64;
+    static const int unreachable = INF / 2;
+
+private:
+    int n;
+    int stride;        // длина строки, кратная 8 (регистр AVX2)
+    vector<int> storage;
+    int* data;         // начало матрицы, выровненное на 32 байта
+    int threads;
+
+    // row[j] = min(row[j], dik + rowK[j]) для j из [j0, j1). При dik < 0 сумма с
+    // unreachable могла бы стать "достижимой", поэтому такие rowK[j] пропускаются
+    static void relaxRow(int* row, const int* rowK, int dik, int j0, int j1) {
+        int j = j0;
+        if (dik >= 0) {
+#if defined(__AVX2__)
+            __m256i d = _mm256_set1_epi32(dik);
+            for (; j + 8 <= j1; j += 8) {
+                __m256i through = _mm256_add_epi32(d, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rowK + j)));
+                __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + j));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + j), _mm256_min_epi32(current, through));
+            }
+#endif
+            for (; j < j1; ++j) {
+                int through = dik + rowK[j];
+                row[j] = through < row[j] ? through : row[j];
+            }
+        }
+        else {
+            for (; j < j1; ++j) {
+                if (rowK[j] < unreachable) row[j] = min(row[j], dik + rowK[j]);
+            }
+        }
+    }
+
+    // Блок строк [i0, i1) x столбцов [j0, j1) через вершины [k0, k1). kOuter - для блоков,
+    // в которых лежат сами строки k: там порядок k обязан быть внешним
+    void relaxBlock(int i0, int i1, int j0, int j1, int k0, int k1, bool kOuter) {
+        if (kOuter) {
+            for (int k = k0; k < k1; ++k) {
+                const int* rowK = row(k);
+                for (int i = i0; i < i1; ++i) {
+                    int dik = row(i)[k];
+                    if (dik < unreachable) relaxRow(row(i), rowK, dik, j0, j1);
+                }
+            }
+        }
+        else {
+            for (int i = i0; i < i1; ++i) {
+                int* rowI = row(i);
+                for (int k = k0; k < k1; ++k) {
+                    int dik = rowI[k];
+                    if (dik < unreachable) relaxRow(rowI, row(k), dik, j0, j1);
+                }
+            }
+        }
+    }
+
+    // Плитки вне [k0, k1) на отрезке [0, end)
+    static vector<pair<int, int>> tilesOutside(int k0, int k1, int end) {
+        vector<pair<int, int>> tiles;
+        for (int a = 0; a < k0; a += tile) tiles.emplace_back(a, min(a + tile, k0));
+        for (int a = k1; a < end; a += tile) tiles.emplace_back(a, min(a + tile, end));
+        return tiles;
+    }
+
+public:
+    explicit AllPairsShortestPaths(int n)
+        : n(n), stride((n + 7) / 8 * 8), storage(static_cast<size_t>(stride) * n + 8, static_cast<int>(unreachable)), data(nullptr),
+        threads(max(1, static_cast<int>(thread::hardware_concurrency()))) {
+        size_t misalignment = reinterpret_cast<uintptr_t>(storage.data()) % 32 / sizeof(int);
+        data = storage.data() + (misalignment == 0 ? 0 : 8 - misalignment);
+        for (int i = 0; i < n; ++i) row(i)[i] = 0;
+    }
+
+    int size() const { return n; }
+    int* row(int i) { return data + static_cast<size_t>(i) * stride; }
+    const int* row(int i) const { return data + static_cast<size_t>(i) * stride; }
+
+    // INF вместо unreachable, как в остальных алгоритмах
+    int distance(int i, int j) const {
+        int d = row(i)[j];
+        return d >= unreachable ? INF : d;
+    }
+
+    void addEdge(int from, int to, int weight) {
+        int& d = row(from)[to];
+        d = min(d, weight);
+    }
+
+    void relax(int k0, int k1) {
+        // Мелкие задачи (пошаговый показ) дешевле сделать в одном потоке
+        int workers = static_cast<long long>(n) * n * (k1 - k0) < (1 << 20) ? 1 : threads;
+        vector<pair<int, int>> rows = tilesOutside(k0, k1, n);
+        vector<pair<int, int>> columns = tilesOutside(k0, k1, stride);
+        int columnCount = static_cast<int>(columns.size());
+
+        relaxBlock(k0, k1, k0, k1, k0, k1, true);
+        parallelFor(columnCount + static_cast<int>(rows.size()), workers, [&](int t) {
+            if (t < columnCount) relaxBlock(k0, k1, columns[t].first, columns[t].second, k0, k1, true);
+            else relaxBlock(rows[t - columnCount].first, rows[t - columnCount].second, k0, k1, k0, k1, false);
+        });
+        parallelFor(static_cast<int>(rows.size()) * columnCount, workers, [&](int t) {
+            const pair<int, int>& r = rows[t / columnCount];
+            const pair<int, int>& c = columns[t % columnCount];
+            relaxBlock(r.first, r.second, c.first, c.second, k0, k1, false);
+        });
+    }
+
+    void solve() {
+        for (int k = 0; k < n; k += tile) relax(k, min(k + tile, n));
+    }
+};
+
+// Флойд-Уоршелл: шаг - одна промежуточная вершина k, до конца - блоками по tile вершин.
+// На вершинах показываются расстояния от стартовой вершины по текущей матрице, а
+// предшественники - дерево из рёбер, на которых эти расстояния достигаются.
+class FloydAlgorithm : public GraphAlgorithm {
+private:
+    AllPairsShortestPaths paths;
+    int k;
+
+    void publishRow() {
+        readRow();
+        publishAll();
+    }
+
+    void readRow() {
+        for (int v = 0; v < n; ++v) {
+            distance[v] = paths.distance(start, v);
+            visited[v] = v < k;
+            predecessor[v] = -1;
+            predecessorEdge[v] = -1;
+        }
+        vector<bool> reached(n, false);
+        vector<int> order(1, start);
+        reached[start] = true;
+        for (size_t head = 0; head < order.size(); ++head) {
+            int u = order[head];
+            for (int arc = adjacency.rowBegin(u); arc < adjacency.rowEnd(u); ++arc) {
+                int v = adjacency.target(arc);
+                if (reached[v] || distance[v] == INF || distance[u] + adjacency.weight(arc) != distance[v]) continue;
+                reached[v] = true;
+                predecessor[v] = u;
+                predecessorEdge[v] = adjacency.edge(arc);
+                order.push_back(v);
+            }
+        }
+    }
+
+protected:
+    bool advance(bool publish) override {
+        if (k == n) {
+            readRow();
+            info = "Floyd finished";
+            return false;
+        }
+        int kEnd = publish ? k + 1 : min(n, (k / AllPairsShortestPaths::tile + 1) * AllPairsShortestPaths::tile);
+        paths.relax(k, kEnd);
+        k = kEnd;
+        if (publish) {
+            publishRow();
+            info = "Floyd: relaxed paths through " + to_string(k - 1);
+        }
+        return true;
+    }
+
+public:
+    // Матрица V x V в int: 8192 вершины - 256 МБ
+    static const int maxNodes = 8192;
+
+    FloydAlgorithm(Graph& graph, int start) : GraphAlgorithm(graph, start), paths(n), k(0) {
+        for (int i = 0; i < n; ++i) {
+            for (int arc = adjacency.rowBegin(i); arc < adjacency.rowEnd(i); ++arc) {
+                paths.addEdge(i, adjacency.target(arc), adjacency.weight(arc));
+            }
+        }
+        publishRow();
+        info = "Floyd started from " + to_string(start) + " - SPACE: step, R: run to end";
+    }
+};
+
 class GraphVisualizer {
 private:
     Graph graph;
     int selectedNode;
     bool showWeights;
     string algorithmInfo;
-    bool algorithmRunning;
-    int algorithmStep;
+    unique_ptr<GraphAlgorithm> algorithm;
+    RenderBatch batch;
+    int viewWidth, viewHeight;  // текущий размер окна, по нему отсекаются вершины и рёбра
     bool edgeCreationMode;
     int edgeCreationFrom;
     int edgeWeightInput;
@@ -269,19 +1464,43 @@ private:
     bool firstNodeSelected;
 
 public:
-    GraphVisualizer() : selectedNode(-1), showWeights(true), algorithmRunning(false),
-        algorithmStep(0), edgeCreationMode(false), edgeCreationFrom(-1),
+    GraphVisualizer() : selectedNode(-1), showWeights(true), viewWidth(WINDOW_WIDTH), viewHeight(WINDOW_HEIGHT),
+        edgeCreationMode(false), edgeCreationFrom(-1),
         edgeWeightInput(1), weightInputMode(false), firstNodeSelected(false) {}
 
+    void resize(int w, int h) {
+        viewWidth = w;
+        viewHeight = h;
+    }
+
     void draw() {
-        // Рисуем ребра
-        for (const auto& edge : graph.getEdges()) {
-            edge.draw(graph.getNodes(), graph.isDirected(), showWeights);
+        float x0 = -NODE_RADIUS, y0 = -NODE_RADIUS;
+        float x1 = viewWidth + NODE_RADIUS, y1 = viewHeight + NODE_RADIUS;
+
+        // Рисуем ребра, чей описанный прямоугольник задевает окно
+        const vector<GraphEdge>& edges = graph.getEdges();
+        vector<int> visibleEdges;
+        for (size_t i = 0; i < edges.size(); ++i) {
+            if (edges[i].overlapsRect(graph.getNodes(), x0, y0, x1, y1)) visibleEdges.push_back(static_cast<int>(i));
+        }
+        for (int i : visibleEdges) {
+            edges[i].draw(batch, graph.getNodes(), graph.isDirected());
+        }
+        batch.flush();
+
+        // Рисуем узлы, задевающие окно
+        vector<int> visible = graph.findNodesInRect(x0, y0, x1, y1);
+        for (int id : visible) {
+            graph.getNodes()[id].draw(batch);
         }
+        batch.flush();
 
-        // Рисуем узлы
-        for (const auto& node : graph.getNodes()) {
-            node.draw();
+        // Подписи - поверх всей геометрии
+        for (int i : visibleEdges) {
+            edges[i].drawLabel(graph.getNodes(), showWeights);
+        }
+        for (int id : visible) {
+            graph.getNodes()[id].drawLabels();
         }
 
         // Отображаем информацию об алгоритме
@@ -291,7 +1510,7 @@ public:
         // Инструкции
         drawText(10, 20, "Left click: Add node | Right click: Select node");
         drawText(10, 40, "E: Add edge | W: Edit weight | D: Delete node");
-        drawText(10, 60, "T: Toggle directed | 1-4: Algorithms | ESC: Cancel");
+        drawText(10, 60, "T: Toggle directed | 1-4: Algorithms | SPACE: Step | R: Run to end | ESC: Cancel");
 
         // Режим создания ребра
         if (edgeCreationMode) {
@@ -319,15 +1538,7 @@ public:
             if (weightInputMode) return;
 
             // Проверяем, не кликнули ли по существующей вершине
-            int clickedNode = -1;
-            for (size_t i = 0; i < graph.getNodes().size(); ++i) {
-                float dx = graph.getNodes()[i].getX() - x;
-                float dy = graph.getNodes()[i].getY() - y;
-                if (dx * dx + dy * dy <= NODE_RADIUS * NODE_RADIUS) {
-                    clickedNode = static_cast<int>(i);
-                    break;
-                }
-            }
+            int clickedNode = graph.findNodeAt(static_cast<float>(x), static_cast<float>(y));
 
             if (edgeCreationMode) {
                 if (clickedNode != -1) {
@@ -344,27 +1555,21 @@ public:
                 }
                 else if (!firstNodeSelected) {
                     // Добавляем новую вершину
+                    stopAlgorithm();
                     graph.addNode(static_cast<float>(x), static_cast<float>(y));
                 }
             }
             else {
                 // Обычный режим - добавляем новую вершину
                 if (clickedNode == -1) {
+                    stopAlgorithm();
                     graph.addNode(static_cast<float>(x), static_cast<float>(y));
                 }
             }
         }
         else if (button == GLUT_RIGHT_BUTTON && state == GLUT_DOWN) {
             // Выбор вершины правой кнопкой
-            selectedNode = -1;
-            for (size_t i = 0; i < graph.getNodes().size(); ++i) {
-                float dx = graph.getNodes()[i].getX() - x;
-                float dy = graph.getNodes()[i].getY() - y;
-                if (dx * dx + dy * dy <= NODE_RADIUS * NODE_RADIUS) {
-                    selectedNode = static_cast<int>(i);
-                    break;
-                }
-            }
+            selectedNode = graph.findNodeAt(static_cast<float>(x), static_cast<float>(y));
         }
     }
 
@@ -376,6 +1581,7 @@ public:
             else if (key == 13) { // Enter
                 // Завершаем создание ребра
                 if (firstNodeSelected && selectedNode != -1 && selectedNode != edgeCreationFrom) {
+                    stopAlgorithm();
                     graph.addEdge(edgeCreationFrom, selectedNode, edgeWeightInput);
                 }
                 resetEdgeCreation();
@@ -398,25 +1604,25 @@ public:
 
         case 'w': case 'W':
             if (selectedNode != -1) {
-                // Находим первое ребро, связанное с выбранной вершиной
-                for (auto& edge : graph.getEdges()) {
-                    if (edge.getFrom() == selectedNode  edge.getTo() == selectedNode) {
-                        weightInputMode = true;
-                        edgeWeightInput = edge.getWeight();
-                        break;
-                    }
+                // Берём первое ребро, связанное с выбранной вершиной
+                const vector<int>& incident = graph.getIncidentEdges(selectedNode);
+                if (!incident.empty()) {
+                    weightInputMode = true;
+                    edgeWeightInput = graph.getEdges()[incident.front()].getWeight();
                 }
             }
             break;
 
         case 'd': case 'D':
             if (selectedNode != -1) {
+                stopAlgorithm();
                 graph.removeNode(selectedNode);
                 selectedNode = -1;
             }
             break;
 
         case 't': case 'T':
+            stopAlgorithm();
             graph.toggleDirected();
             algorithmInfo = graph.isDirected() ? "Directed graph" : "Undirected graph";
             break;
@@ -425,7 +1631,24 @@ public:
         case '2': runDFS(); break;
         case '3': runDijkstra(); break;
         case '4': runFloyd(); break;
+        case ' ':
+            if (algorithm) {
+                if (!algorithm->step()) algorithm.reset();
+                else algorithmInfo = algorithm->getInfo();
+            }
+            break;
+        case 'r': case 'R':
+            if (algorithm) {
+                algorithm->runToEnd();
+                algorithmInfo = algorithm->getInfo();
+                algorithm.reset();
+            }
+            break;
         case 27: // Escape
+            if (algorithm) {
+                stopAlgorithm();
+                algorithmInfo = "Algorithm cancelled";
+            }
             resetEdgeCreation();
             break;
         }
@@ -448,44 +1671,130 @@ private:
         }
     }
 
+    // Алгоритм стартует из выбранной вершины, а если её нет - из первой живой
+    int startNode() const {
+        return selectedNode != -1 ? selectedNode : graph.firstAliveNode();
+    }
+
+    void startAlgorithm(GraphAlgorithm* created) {
+        algorithm.reset(created);
+        algorithmInfo = algorithm->getInfo();
+    }
+
+    // Граф меняется - списки смежности запущенного алгоритма больше не верны
+    void stopAlgorithm() {
+        if (!algorithm) return;
+        algorithm.reset();
+        graph.resetAlgorithmState();
+    }
+
     void runBFS() {
-        if (!graph.getNodes().empty() && !algorithmRunning) {
-            graph.resetAlgorithmState();
-            algorithmRunning = true;
-            algorithmStep = 0;
-            algorithmInfo = "BFS started - press SPACE for next step";
+        if (graph.getNodeCount() > 0 && !algorithm) {
+            startAlgorithm(new BFSAlgorithm(graph, startNode()));
         }
     }
 
     void runDFS() {
-        if (!graph.getNodes().empty() && !algorithmRunning) {
-            graph.resetAlgorithmState();
-            algorithmRunning = true;
-            algorithmStep = 1;
-            algorithmInfo = "DFS started - press SPACE for next step";
+        if (graph.getNodeCount() > 0 && !algorithm) {
+            startAlgorithm(new DFSAlgorithm(graph, startNode()));
         }
     }
     void runDijkstra() {
-        if (!graph.getNodes().empty() && !algorithmRunning) {
-            graph.resetAlgorithmState();
-            algorithmRunning = true;
-            algorithmStep = 2;
-            algorithmInfo = "Dijkstra started - press SPACE for next step";
+        if (graph.getNodeCount() > 0 && !algorithm) {
+            startAlgorithm(createDijkstra(graph, startNode()));
         }
     }
 
     void runFloyd() {
-        if (!graph.getNodes().empty() && !algorithmRunning) {
-            graph.resetAlgorithmState();
-            algorithmRunning = true;
-            algorithmStep = 3;
-            algorithmInfo = "Floyd started - press SPACE for next step";
+        if (graph.getNodes().size() > static_cast<size_t>(FloydAlgorithm::maxNodes)) {
+            algorithmInfo = "Floyd: too many nodes, use Dijkstra";
+        }
+        else if (graph.getNodeCount() > 0 && !algorithm) {
+            startAlgorithm(new FloydAlgorithm(graph, startNode()));
         }
     }
 };
 
 GraphVisualizer visualizer;
 
+template<typename Queue>
+double timeDijkstra(Graph& graph, Queue queue, vector<int>& distances) {
+    auto start = chrono::steady_clock::now();
+    DijkstraAlgorithm<Queue> dijkstra(graph, 0, move(queue), "");
+    dijkstra.runToEnd();
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    distances = dijkstra.getDistances();
+    return ms;
+}
+
+// Замер очередей Дейкстры на случайном графе:
+//   graphs --bench [--nodes N] [--degree D] [--max-weight W] [--seed N] [--repeat R]
+// Граф ориентированный, из каждой вершины D рёбер со случайными весами 1..W, плюс
+// цикл 0 -> 1 -> ... -> 0, чтобы всё было достижимо. Время - лучшее из R прогонов.
+int runBenchmark(int argc, char** argv) {
+    int nodeCount = 1000000;
+    int degree = 4;
+    int maxWeight = 9;
+    unsigned seed = 1;
+    int repeat = 3;
+
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--nodes" && i + 1 < argc) nodeCount = atoi(argv[++i]);
+        else if (arg == "--degree" && i + 1 < argc) degree = atoi(argv[++i]);
+        else if (arg == "--max-weight" && i + 1 < argc) maxWeight = atoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--repeat" && i + 1 < argc) repeat = atoi(argv[++i]);
+    }
+    if (nodeCount < 1 || degree < 0 || maxWeight < 1 || repeat < 1) {
+        cerr << "bad benchmark parameters" << endl;
+        return 1;
+    }
+
+    Graph graph;
+    graph.toggleDirected();
+    mt19937 rng(seed);
+    uniform_int_distribution<int> nodeDist(0, nodeCount - 1);
+    uniform_int_distribution<int> weightDist(1, maxWeight);
+    for (int v = 0; v < nodeCount; ++v) {
+        graph.addNode(static_cast<float>(v % WINDOW_WIDTH), static_cast<float>(v / WINDOW_WIDTH % WINDOW_HEIGHT));
+    }
+    for (int v = 0; v < nodeCount; ++v) {
+        graph.addEdge(v, (v + 1) % nodeCount, weightDist(rng));
+        for (int d = 0; d < degree; ++d) {
+            graph.addEdge(v, nodeDist(rng), weightDist(rng));
+        }
+    }
+    graph.getAdjacency();
+
+    const char* names[] = { "priority_queue", "4-ary heap", "buckets" };
+    double best[3] = { 0, 0, 0 };
+    vector<int> reference;
+    bool consistent = true;
+    for (int r = 0; r < repeat; ++r) {
+        vector<int> distances[3];
+        double ms[3];
+        ms[0] = timeDijkstra(graph, BinaryHeapQueue(), distances[0]);
+        ms[1] = timeDijkstra(graph, IndexedHeap(nodeCount), distances[1]);
+        ms[2] = timeDijkstra(graph, BucketQueue(maxWeight), distances[2]);
+        for (int q = 0; q < 3; ++q) {
+            best[q] = r == 0 ? ms[q] : min(best[q], ms[q]);
+            if (distances[q] != distances[0]) consistent = false;
+        }
+    }
+
+    cout << "queue,nodes,edges,max_weight,time_ms,speedup\n";
+    for (int q = 0; q < 3; ++q) {
+        cout << names[q] << "," << nodeCount << "," << graph.getEdges().size() << "," << maxWeight << ","
+            << best[q] << "," << best[0] / best[q] << "\n";
+    }
+    if (!consistent) {
+        cerr << "distances differ between queues" << endl;
+        return 1;
+    }
+    return 0;
+}
+
 void display() {
     glClear(GL_COLOR_BUFFER_BIT);
     visualizer.draw();
@@ -493,6 +1802,7 @@ void display() {
 }
 
 void reshape(int w, int h) {
+    visualizer.resize(w, h);
     glViewport(0, 0, w, h);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
@@ -514,7 +1824,81 @@ void timer(int value) {
     glutTimerFunc(1000, timer, 0);
 }
 
+// Замер блочного Флойда-Уоршелла против простого тройного цикла по vector<vector<int>>:
+//   graphs --bench-floyd [--nodes N] [--degree D] [--seed N]
+// Простой вариант запускается до 2048 вершин, его ответ сверяется с блочным.
+int runFloydBenchmark(int argc, char** argv) {
+    int nodeCount = 2048;
+    int degree = 8;
+    unsigned seed = 1;
+
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--nodes" && i + 1 < argc) nodeCount = atoi(argv[++i]);
+        else if (arg == "--degree" && i + 1 < argc) degree = atoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+    }
+    if (nodeCount < 1 || degree < 0) {
+        cerr << "bad benchmark parameters" << endl;
+        return 1;
+    }
+
+    mt19937 rng(seed);
+    uniform_int_distribution<int> nodeDist(0, nodeCount - 1);
+    uniform_int_distribution<int> weightDist(1, 9);
+    vector<vector<int>> naive(nodeCount, vector<int>(nodeCount, INF));
+    AllPairsShortestPaths paths(nodeCount);
+    for (int v = 0; v < nodeCount; ++v) {
+        naive[v][v] = 0;
+        for (int d = 0; d < degree; ++d) {
+            int to = nodeDist(rng);
+            int w = weightDist(rng);
+            naive[v][to] = min(naive[v][to], v == to ? 0 : w);
+            paths.addEdge(v, to, w);
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    paths.solve();
+    double tiledMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "engine,nodes,time_ms\n";
+    cout << "tiled," << nodeCount << "," << tiledMs << "\n";
+    if (nodeCount > 2048) return 0;
+
+    start = chrono::steady_clock::now();
+    for (int k = 0; k < nodeCount; ++k) {
+        for (int i = 0; i < nodeCount; ++i) {
+            if (naive[i][k] == INF) continue;
+            for (int j = 0; j < nodeCount; ++j) {
+                if (naive[k][j] != INF && naive[i][k] + naive[k][j] < naive[i][j]) {
+                    naive[i][j] = naive[i][k] + naive[k][j];
+                }
+            }
+        }
+    }
+    double naiveMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "naive," << nodeCount << "," << naiveMs << "\n";
+
+    for (int i = 0; i < nodeCount; ++i) {
+        for (int j = 0; j < nodeCount; ++j) {
+            if (naive[i][j] != paths.distance(i, j)) {
+                cerr << "distances differ at " << i << " -> " << j << endl;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char** argv) {
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        return runBenchmark(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-floyd") {
+        return runFloydBenchmark(argc, argv);
+    }
+
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
     glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
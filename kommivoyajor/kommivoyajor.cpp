@@ -1,20 +1,176 @@
-﻿#include <GL/glut.h>
+﻿// Ядра AVX2 компилируются отдельными функциями под target("avx2") (MSVC разрешает
+// интринсики без /arch), а выбираются при запуске по CPUID
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define TSP_AVX2_KERNELS
+#define TSP_AVX2_TARGET
+#include <intrin.h>
+#include <immintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TSP_AVX2_KERNELS
+#define TSP_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#include <GL/glut.h>
 #include <vector>
 #include <iostream>
 #include <algorithm>
 #include <limits>
 #include <string>
 #include <sstream>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <random>
+#include <condition_variable>
+#include <list>
+#include <array>
 
 using namespace std;
 
-const int maxSize = 20;
 const int WINDOW_WIDTH = 1000;
 const int WINDOW_HEIGHT = 700;
 const float NODE_RADIUS = 20.0f;
 const float PI = 3.14159265358979323846f;
 const int INF = numeric_limits<int>::max();
 
+enum class TSPMethod {
+    Exhaustive,
+    HeldKarp,
+    BranchAndBound,
+    ParallelBranchAndBound,
+    AssignmentBranchAndBound,
+    Heuristic
+};
+
+const char* TSPMethodName(TSPMethod method) {
+    switch (method) {
+    case TSPMethod::HeldKarp: return "Held-Karp";
+    case TSPMethod::BranchAndBound: return "Branch and bound";
+    case TSPMethod::ParallelBranchAndBound: return "Parallel branch and bound";
+    case TSPMethod::AssignmentBranchAndBound: return "ATSP branch and bound (assignment bound)";
+    case TSPMethod::Heuristic: return "Heuristic (NN + 2-opt/Or-opt)";
+    default: return "Exhaustive";
+    }
+}
+
+// Имя решателя для командной строки и пакетных отчётов
+const char* TSPMethodKey(TSPMethod method) {
+    switch (method) {
+    case TSPMethod::HeldKarp: return "held-karp";
+    case TSPMethod::BranchAndBound: return "bnb";
+    case TSPMethod::ParallelBranchAndBound: return "parallel-bnb";
+    case TSPMethod::AssignmentBranchAndBound: return "ap-bnb";
+    case TSPMethod::Heuristic: return "heuristic";
+    default: return "exhaustive";
+    }
+}
+
+TSPMethod NextTSPMethod(TSPMethod method) {
+    switch (method) {
+    case TSPMethod::Exhaustive: return TSPMethod::HeldKarp;
+    case TSPMethod::HeldKarp: return TSPMethod::BranchAndBound;
+    case TSPMethod::BranchAndBound: return TSPMethod::ParallelBranchAndBound;
+    case TSPMethod::ParallelBranchAndBound: return TSPMethod::AssignmentBranchAndBound;
+    case TSPMethod::AssignmentBranchAndBound: return TSPMethod::Heuristic;
+    default: return TSPMethod::Exhaustive;
+    }
+}
+
+// Счётчики поиска: для деревьев перебора - раскрытые узлы, для Хелда-Карпа -
+// вычисленные состояния dp, для эвристики - применённые улучшающие ходы.
+// Деревья перебора дополнительно считают отсечённые по границе узлы, разбивку по
+// глубине и улучшения рекорда с временем от начала поиска.
+struct SearchStats {
+    struct Incumbent {
+        int cost;
+        double milliseconds;
+    };
+
+    long long nodesExpanded;
+    long long nodesPruned;
+    vector<long long> expandedByDepth;
+    vector<long long> prunedByDepth;
+    vector<Incumbent> incumbents;
+    chrono::steady_clock::time_point started;
+    bool budgetExceeded;        // поиск прерван по лимиту памяти
+    size_t memoryBytes;         // занято таблицами и открытыми узлами решателя сейчас
+    size_t peakMemoryBytes;     // наибольшее значение memoryBytes за поиск
+
+    SearchStats() : nodesExpanded(0), nodesPruned(0), started(chrono::steady_clock::now()), budgetExceeded(false),
+        memoryBytes(0), peakMemoryBytes(0) {}
+
+    // Обнуляет счётчики и заводит разбивку на depths уровней, чтобы при поиске был только инкремент
+    void Reset(int depths) {
+        nodesExpanded = 0;
+        nodesPruned = 0;
+        expandedByDepth.assign(depths, 0);
+        prunedByDepth.assign(depths, 0);
+        incumbents.clear();
+        started = chrono::steady_clock::now();
+        budgetExceeded = false;
+        memoryBytes = 0;
+        peakMemoryBytes = 0;
+    }
+
+    // Учёт собственных структур решателя: объёмы считает сам решатель, а не аллокатор
+    void Allocate(size_t bytes) {
+        memoryBytes += bytes;
+        peakMemoryBytes = max(peakMemoryBytes, memoryBytes);
+    }
+
+    void Release(size_t bytes) { memoryBytes -= bytes; }
+
+    void CountExpanded(int depth) {
+        ++nodesExpanded;
+        if (depth >= static_cast<int>(expandedByDepth.size())) expandedByDepth.resize(depth + 1, 0);
+        ++expandedByDepth[depth];
+    }
+
+    void CountPruned(int depth, long long count = 1) {
+        nodesPruned += count;
+        if (depth >= static_cast<int>(prunedByDepth.size())) prunedByDepth.resize(depth + 1, 0);
+        prunedByDepth[depth] += count;
+    }
+
+    void RecordIncumbent(int cost) {
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        incumbents.push_back({ cost, ms });
+    }
+
+    // Складывает счётчики другого потока; рекорды ведутся в общей статистике
+    void Merge(const SearchStats& other) {
+        nodesExpanded += other.nodesExpanded;
+        nodesPruned += other.nodesPruned;
+        if (expandedByDepth.size() < other.expandedByDepth.size()) expandedByDepth.resize(other.expandedByDepth.size(), 0);
+        if (prunedByDepth.size() < other.prunedByDepth.size()) prunedByDepth.resize(other.prunedByDepth.size(), 0);
+        for (size_t d = 0; d < other.expandedByDepth.size(); ++d) expandedByDepth[d] += other.expandedByDepth[d];
+        for (size_t d = 0; d < other.prunedByDepth.size(); ++d) prunedByDepth[d] += other.prunedByDepth[d];
+    }
+};
+
+bool ParseTSPMethod(const string& key, TSPMethod& method) {
+    TSPMethod candidate = TSPMethod::Exhaustive;
+    do {
+        if (key == TSPMethodKey(candidate)) {
+            method = candidate;
+            return true;
+        }
+        candidate = NextTSPMethod(candidate);
+    } while (candidate != TSPMethod::Exhaustive);
+    return false;
+}
+
 void drawText(float x, float y, const string& text) {
     glRasterPos2f(x, y);
     for (char c : text) {
@@ -22,36 +178,2618 @@ void drawText(float x, float y, const string& text) {
     }
 }
 
+// Векторные ядра (AVX2) с переносимой скалярной версией. Векторная версия обрабатывает
+// целые четвёрки и сдвигает индекс, остаток и процессоры без AVX2 - скалярный цикл;
+// результаты обеих версий совпадают.
+
+// Поддержка AVX2 процессором и сохранение регистров YMM операционной системой
+bool DetectAVX2() {
+#if defined(TSP_AVX2_KERNELS) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(TSP_AVX2_KERNELS)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+const bool cpuHasAVX2 = DetectAVX2();
+
+#if defined(TSP_AVX2_KERNELS)
+TSP_AVX2_TARGET int FirstNegativeDeltaAVX2(const int* plus1, const int* plus2, const int* minus, long long offset,
+    int& i, int count) {
+    __m256i base = _mm256_set1_epi64x(offset);
+    __m256i zero = _mm256_setzero_si256();
+    for (; i + 4 <= count; i += 4) {
+        __m256i a = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(plus1 + i)));
+        __m256i b = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(plus2 + i)));
+        __m256i c = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(minus + i)));
+        __m256i delta = _mm256_add_epi64(_mm256_add_epi64(a, b), _mm256_sub_epi64(base, c));
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(zero, delta)));
+        for (int lane = 0; lane < 4; ++lane) {
+            if (mask & (1 << lane)) return i + lane;
+        }
+    }
+    return -1;
+}
+#endif
+
+// Первый индекс i из [begin, count), для которого plus1[i] + plus2[i] - minus[i] + offset < 0, или -1.
+// Дельты пакета ходов считаются в 64 битах, поэтому веса INF не переполняются.
+int FirstNegativeDelta(const int* plus1, const int* plus2, const int* minus, long long offset,
+    int begin, int count) {
+    int i = begin;
+#if defined(TSP_AVX2_KERNELS)
+    if (cpuHasAVX2) {
+        int found = FirstNegativeDeltaAVX2(plus1, plus2, minus, offset, i, count);
+        if (found != -1) return found;
+    }
+#endif
+    for (; i < count; ++i) {
+        if (static_cast<long long>(plus1[i]) + plus2[i] - minus[i] + offset < 0) return i;
+    }
+    return -1;
+}
+
+// Стоимость замкнутого обхода tour (в индексах); INF, если какого-то ребра нет
+int TourCost(const vector<int>& cost, int n, const vector<int>& tour) {
+    if (tour.empty()) return INF;
+    long long total = 0;
+    for (size_t i = 0; i < tour.size(); ++i) {
+        int w = cost[static_cast<size_t>(tour[i]) * n + tour[(i + 1) % tour.size()]];
+        if (w == INF) return INF;
+        total += w;
+    }
+    return total >= INF ? INF : static_cast<int>(total);
+}
+
+// "Ближайший сосед" из каждой стартовой вершины; лучший обход повёрнут так, чтобы начинаться с 0
+pair<vector<int>, int> NearestNeighbourTour(const vector<int>& cost, int n) {
+    vector<int> bestTour;
+    int bestCost = INF;
+    vector<bool> visited(n);
+    vector<int> tour;
+    tour.reserve(n);
+
+    for (int start = 0; start < n; ++start) {
+        fill(visited.begin(), visited.end(), false);
+        tour.clear();
+        tour.push_back(start);
+        visited[start] = true;
+        int current = start;
+        for (int step = 1; step < n; ++step) {
+            int next = -1;
+            for (int j = 0; j < n; ++j) {
+                int w = cost[static_cast<size_t>(current) * n + j];
+                if (!visited[j] && w != INF && (next == -1 || w < cost[static_cast<size_t>(current) * n + next])) {
+                    next = j;
+                }
+            }
+            if (next == -1) break;
+            visited[next] = true;
+            tour.push_back(next);
+            current = next;
+        }
+        if (static_cast<int>(tour.size()) != n) continue;
+
+        rotate(tour.begin(), find(tour.begin(), tour.end(), 0), tour.end());
+        int tourCost = TourCost(cost, n, tour);
+        if (tourCost < bestCost) {
+            bestCost = tourCost;
+            bestTour = tour;
+        }
+    }
+    return { bestTour, bestCost };
+}
+
+// Доступ к весам через плотную матрицу n x n
+struct MatrixDistance {
+    const vector<int>& cost;
+    int n;
+
+    MatrixDistance(const vector<int>& cost, int n) : cost(cost), n(n) {}
+
+    int operator()(int a, int b) const { return cost[static_cast<size_t>(a) * n + b]; }
+};
+
+// Симметризация несимметричной матрицы для локального поиска: ходы с разворотом
+// участка оцениваются по сумме весов в обе стороны, чтобы поиск гарантированно сходился
+struct SymmetricDistance {
+    const vector<int>& cost;
+    int n;
+
+    SymmetricDistance(const vector<int>& cost, int n) : cost(cost), n(n) {}
+
+    int operator()(int a, int b) const {
+        int forward = cost[static_cast<size_t>(a) * n + b];
+        int backward = cost[static_cast<size_t>(b) * n + a];
+        if (forward == INF || backward == INF) return INF;
+        return forward + backward;
+    }
+};
+
+// Евклидовы расстояния по координатам с округлением TSPLIB EUC_2D, без матрицы весов.
+// Координаты лежат отдельными массивами x и y, чтобы пакет расстояний считался векторно.
+struct EuclideanDistance {
+    vector<double> x;
+    vector<double> y;
+
+    EuclideanDistance(vector<double> xs, vector<double> ys) : x(move(xs)), y(move(ys)) {}
+
+    int operator()(int a, int b) const {
+        double dx = x[a] - x[b];
+        double dy = y[a] - y[b];
+        return static_cast<int>(sqrt(dx * dx + dy * dy) + 0.5);
+    }
+};
+
+// Пакетная выборка out[i] = dist(from[i], to[i])
+template <typename Distance>
+void GatherDistances(const Distance& dist, const int* from, const int* to, int count, int* out) {
+    for (int i = 0; i < count; ++i) out[i] = dist(from[i], to[i]);
+}
+
+#if defined(TSP_AVX2_KERNELS)
+TSP_AVX2_TARGET void GatherDistancesAVX2(const EuclideanDistance& dist, const int* from, const int* to,
+    int& i, int count, int* out) {
+    __m256d half = _mm256_set1_pd(0.5);
+    // Выборка с маской и нулевым источником: у немаскированной GCC видит неинициализированный регистр
+    __m256d zero = _mm256_setzero_pd();
+    __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    const double* xs = dist.x.data();
+    const double* ys = dist.y.data();
+    for (; i + 4 <= count; i += 4) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(to + i));
+        __m256d dx = _mm256_sub_pd(_mm256_mask_i32gather_pd(zero, xs, a, all, 8), _mm256_mask_i32gather_pd(zero, xs, b, all, 8));
+        __m256d dy = _mm256_sub_pd(_mm256_mask_i32gather_pd(zero, ys, a, all, 8), _mm256_mask_i32gather_pd(zero, ys, b, all, 8));
+        __m256d length = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_cvttpd_epi32(_mm256_add_pd(length, half)));
+    }
+}
+#endif
+
+// По координатам - четыре расстояния за одну выборку и один корень AVX2
+void GatherDistances(const EuclideanDistance& dist, const int* from, const int* to, int count, int* out) {
+    int i = 0;
+#if defined(TSP_AVX2_KERNELS)
+    if (cpuHasAVX2) GatherDistancesAVX2(dist, from, to, i, count, out);
+#endif
+    for (; i < count; ++i) out[i] = dist(from[i], to[i]);
+}
+
+// Строка расстояний out[j] = dist(from, j) для всех j < n
+template <typename Distance>
+void DistanceRow(const Distance& dist, int from, int n, int* out) {
+    for (int j = 0; j < n; ++j) out[j] = dist(from, j);
+}
+
+#if defined(TSP_AVX2_KERNELS)
+TSP_AVX2_TARGET void DistanceRowAVX2(const EuclideanDistance& dist, int from, int& j, int n, int* out) {
+    __m256d fromX = _mm256_set1_pd(dist.x[from]);
+    __m256d fromY = _mm256_set1_pd(dist.y[from]);
+    __m256d half = _mm256_set1_pd(0.5);
+    for (; j + 4 <= n; j += 4) {
+        __m256d dx = _mm256_sub_pd(fromX, _mm256_loadu_pd(dist.x.data() + j));
+        __m256d dy = _mm256_sub_pd(fromY, _mm256_loadu_pd(dist.y.data() + j));
+        __m256d length = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), _mm256_cvttpd_epi32(_mm256_add_pd(length, half)));
+    }
+}
+#endif
+
+// Координаты городов j идут подряд, поэтому строка считается без выборки по индексам
+void DistanceRow(const EuclideanDistance& dist, int from, int n, int* out) {
+    int j = 0;
+#if defined(TSP_AVX2_KERNELS)
+    if (cpuHasAVX2) DistanceRowAVX2(dist, from, j, n, out);
+#endif
+    for (; j < n; ++j) out[j] = dist(from, j);
+}
+
+// Длина замкнутого обхода одним пакетом рёбер tour[i] -> tour[i + 1]
+template <typename Distance>
+long long TourLength(const Distance& dist, const vector<int>& tour) {
+    int m = static_cast<int>(tour.size());
+    if (m == 0) return 0;
+    vector<int> weights(m);
+    GatherDistances(dist, tour.data(), tour.data() + 1, m - 1, weights.data());
+    weights[m - 1] = dist(tour[m - 1], tour[0]);
+    long long total = 0;
+    for (int w : weights) total += w;
+    return total;
+}
+
+// k-d дерево по координатам городов: k ближайших и соседи в радиусе за O(log n) в среднем,
+// без матрицы расстояний. Дерево неявное: узел - отрезок [lo, hi) массива items, его
+// медиана стоит в середине отрезка и делит его по оси с наибольшим разбросом.
+// Города можно удалять (для "ближайшего соседа" по непосещённым): alive[mid] - число
+// неудалённых городов в отрезке узла, пустые поддеревья не обходятся.
+class KdTree {
+private:
+    const vector<double>& x;
+    const vector<double>& y;
+    int n;
+    vector<int> items;
+    vector<char> axis;      // ось разбиения узла с медианой в позиции mid
+    vector<int> alive;
+    vector<int> slot;       // позиция города в items
+    vector<char> removed;
+
+    double Coord(int city, int a) const { return a == 0 ? x[city] : y[city]; }
+
+    void Build(int lo, int hi) {
+        if (lo >= hi) return;
+        double minX = x[items[lo]], maxX = minX, minY = y[items[lo]], maxY = minY;
+        for (int i = lo + 1; i < hi; ++i) {
+            minX = min(minX, x[items[i]]);
+            maxX = max(maxX, x[items[i]]);
+            minY = min(minY, y[items[i]]);
+            maxY = max(maxY, y[items[i]]);
+        }
+        int mid = lo + (hi - lo) / 2;
+        int a = maxX - minX >= maxY - minY ? 0 : 1;
+        axis[mid] = static_cast<char>(a);
+        alive[mid] = hi - lo;
+        nth_element(items.begin() + lo, items.begin() + mid, items.begin() + hi,
+            [this, a](int p, int q) { return Coord(p, a) < Coord(q, a); });
+        Build(lo, mid);
+        Build(mid + 1, hi);
+    }
+
+    // heap - куча по убыванию из не более чем k пар (квадрат расстояния, город)
+    void SearchNearest(int lo, int hi, double px, double py, int k, int skip,
+        vector<pair<double, int>>& heap) const {
+        if (lo >= hi) return;
+        int mid = lo + (hi - lo) / 2;
+        if (alive[mid] == 0) return;
+
+        int city = items[mid];
+        if (city != skip && !removed[city]) {
+            double dx = x[city] - px;
+            double dy = y[city] - py;
+            pair<double, int> candidate(dx * dx + dy * dy, city);
+            if (static_cast<int>(heap.size()) < k) {
+                heap.push_back(candidate);
+                push_heap(heap.begin(), heap.end());
+            }
+            else if (candidate < heap.front()) {
+                pop_heap(heap.begin(), heap.end());
+                heap.back() = candidate;
+                push_heap(heap.begin(), heap.end());
+            }
+        }
+
+        // Сначала половина с точкой запроса, дальняя - только если может дать ближе k-го
+        double diff = (axis[mid] == 0 ? px : py) - Coord(city, axis[mid]);
+        if (diff < 0) {
+            SearchNearest(lo, mid, px, py, k, skip, heap);
+            if (static_cast<int>(heap.size()) < k || diff * diff <= heap.front().first) {
+                SearchNearest(mid + 1, hi, px, py, k, skip, heap);
+            }
+        }
+        else {
+            SearchNearest(mid + 1, hi, px, py, k, skip, heap);
+            if (static_cast<int>(heap.size()) < k || diff * diff <= heap.front().first) {
+                SearchNearest(lo, mid, px, py, k, skip, heap);
+            }
+        }
+    }
+
+    void SearchRadius(int lo, int hi, double px, double py, double r2, vector<int>& out) const {
+        if (lo >= hi) return;
+        int mid = lo + (hi - lo) / 2;
+        if (alive[mid] == 0) return;
+
+        int city = items[mid];
+        double dx = x[city] - px;
+        double dy = y[city] - py;
+        if (!removed[city] && dx * dx + dy * dy <= r2) out.push_back(city);
+
+        double diff = (axis[mid] == 0 ? px : py) - Coord(city, axis[mid]);
+        if (diff < 0 || diff * diff <= r2) SearchRadius(lo, mid, px, py, r2, out);
+        if (diff >= 0 || diff * diff <= r2) SearchRadius(mid + 1, hi, px, py, r2, out);
+    }
+
+public:
+    // Координаты не копируются и должны жить дольше дерева
+    KdTree(const vector<double>& x, const vector<double>& y)
+        : x(x), y(y), n(static_cast<int>(x.size())), items(n), axis(n, 0), alive(n, 0), slot(n), removed(n, 0) {
+        for (int i = 0; i < n; ++i) items[i] = i;
+        Build(0, n);
+        for (int i = 0; i < n; ++i) slot[items[i]] = i;
+    }
+
+    // До k ближайших неудалённых городов к точке (кроме skip), по возрастанию расстояния
+    vector<int> KNearest(double px, double py, int k, int skip = -1) const {
+        vector<pair<double, int>> heap;
+        heap.reserve(k);
+        if (k > 0) SearchNearest(0, n, px, py, k, skip, heap);
+        sort_heap(heap.begin(), heap.end());
+        vector<int> result;
+        result.reserve(heap.size());
+        for (const auto& entry : heap) result.push_back(entry.second);
+        return result;
+    }
+
+    // Все неудалённые города на расстоянии не больше r, в порядке обхода дерева
+    vector<int> Radius(double px, double py, double r) const {
+        vector<int> result;
+        if (r >= 0) SearchRadius(0, n, px, py, r * r, result);
+        return result;
+    }
+
+    // Ближайший неудалённый город или -1
+    int Nearest(double px, double py) const {
+        vector<int> nearest = KNearest(px, py, 1);
+        return nearest.empty() ? -1 : nearest[0];
+    }
+
+    void Remove(int city) {
+        if (removed[city]) return;
+        removed[city] = 1;
+        int lo = 0, hi = n;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            --alive[mid];
+            if (slot[city] == mid) break;
+            if (slot[city] < mid) hi = mid;
+            else lo = mid + 1;
+        }
+    }
+
+    // Списки кандидатов для локального поиска: по k ближайших на город, плоским массивом n x k
+    vector<int> NeighbourLists(int k) const {
+        vector<int> lists(static_cast<size_t>(n) * k);
+        for (int i = 0; i < n; ++i) {
+            vector<int> nearest = KNearest(x[i], y[i], k, i);
+            copy(nearest.begin(), nearest.end(), lists.begin() + static_cast<size_t>(i) * k);
+        }
+        return lists;
+    }
+};
+
+// Эвристика для больших задач: "ближайший сосед" по спискам кандидатов, затем
+// локальный поиск 2-opt и Or-opt. Для каждого города рассматриваются только k ближайших
+// соседей, а города без улучшений помечаются битами "не смотреть" и не проверяются,
+// пока не изменятся их рёбра. Обход хранится массивом с позициями городов.
+// Ходы оцениваются в предположении симметричных весов.
+template <typename Distance>
+class LocalSearchSolver {
+private:
+    const Distance& dist;
+    int n;
+    int k;
+    vector<int> neighbours;
+    vector<int> tour;
+    vector<int> pos;
+    deque<int> active;
+    vector<bool> queued;
+    const atomic<bool>* stop;
+    long long moves;
+    // Буферы пакетной оценки ходов: по два кандидата на соседа
+    vector<int> batchFrom, batchTo, batchX, batchY;
+    vector<int> batchAdded, batchPlus1, batchPlus2, batchPlus3, batchPlus4, batchMinus;
+
+    int Next(int city) const { return tour[(pos[city] + 1) % n]; }
+    int Prev(int city) const { return tour[(pos[city] + n - 1) % n]; }
+
+    // Разворот участка обхода от позиции i до позиции j (вперёд по кругу).
+    // Если участок длиннее половины, разворачивается дополнение - цикл получается тот же.
+    void Reverse(int i, int j) {
+        int length = (j - i + n) % n + 1;
+        if (length * 2 > n) {
+            i = (j + 1) % n;
+            j = (i + n - length - 1) % n;
+            length = n - length;
+        }
+        for (int step = 0; step < length / 2; ++step) {
+            int a = tour[i];
+            int b = tour[j];
+            tour[i] = b;
+            pos[b] = i;
+            tour[j] = a;
+            pos[a] = j;
+            i = (i + 1) % n;
+            j = (j + n - 1) % n;
+        }
+    }
+
+    // Удаляет рёбра (a,b), (c,d) и добавляет (a,c), (b,d); b и d - соседи a и c в одном направлении
+    void Move(int a, int b, int c, int d) {
+        if (Next(a) == b) Reverse(pos[b], pos[c]);
+        else Reverse(pos[a], pos[d]);
+    }
+
+    void Activate(int city) {
+        if (!queued[city]) {
+            queued[city] = true;
+            active.push_back(city);
+        }
+    }
+
+    // Веса dist(from, candidates[i]) для всех k соседей города from
+    void GatherFromCity(int from, const int* candidates) {
+        fill(batchFrom.begin(), batchFrom.begin() + k, from);
+        GatherDistances(dist, batchFrom.data(), candidates, k, batchAdded.data());
+    }
+
+    // Кандидаты оцениваются пакетом: выборка весов и дельты всех ходов сразу, затем
+    // берётся первый улучшающий - тот же ход, что нашёл бы поочерёдный перебор
+    bool TryTwoOpt(int a) {
+        const int* candidates = &neighbours[static_cast<size_t>(a) * k];
+        GatherFromCity(a, candidates);
+        for (int direction = 0; direction < 2; ++direction) {
+            int b = direction == 0 ? Next(a) : Prev(a);
+            int removed = dist(a, b);
+            // Списки отсортированы: после первого dist(a, c) >= dist(a, b) выигрыша уже не будет
+            int count = 0;
+            while (count < k && batchAdded[count] < removed) ++count;
+            for (int i = 0; i < count; ++i) {
+                batchFrom[i] = b;
+                batchTo[i] = direction == 0 ? Next(candidates[i]) : Prev(candidates[i]);
+            }
+            GatherDistances(dist, batchFrom.data(), batchTo.data(), count, batchPlus1.data());
+            GatherDistances(dist, candidates, batchTo.data(), count, batchMinus.data());
+
+            for (int i = FirstNegativeDelta(batchAdded.data(), batchPlus1.data(), batchMinus.data(), -removed, 0, count);
+                i != -1;
+                i = FirstNegativeDelta(batchAdded.data(), batchPlus1.data(), batchMinus.data(), -removed, i + 1, count)) {
+                int c = candidates[i];
+                int d = batchTo[i];
+                if (c != b && d != a) {
+                    Move(a, b, c, d);
+                    Activate(a);
+                    Activate(b);
+                    Activate(c);
+                    Activate(d);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Перенос участка из 1-3 городов, начинающегося в a, между двумя соседними городами
+    bool TryOrOpt(int a) {
+        for (int length = 1; length <= 3 && length + 2 < n; ++length) {
+            int first = a;
+            int last = a;
+            for (int i = 1; i < length; ++i) last = Next(last);
+            int p = Prev(first);
+            int nx = Next(last);
+            long long gain = static_cast<long long>(dist(p, first)) + dist(last, nx) - dist(p, nx);
+            if (gain <= 0) continue;
+
+            auto inSegment = [&](int city) { return (pos[city] - pos[first] + n) % n < length; };
+            for (int end = 0; end < 2; ++end) {
+                int from = end == 0 ? first : last;
+                const int* candidates = &neighbours[static_cast<size_t>(from) * k];
+                GatherFromCity(from, candidates);
+                int count = 0;
+                while (count < k && batchAdded[count] < gain) ++count;
+
+                // Кандидат 2i - вставка в ребро (c, следующий), 2i + 1 - в ребро (предыдущий, c)
+                int total = 2 * count;
+                for (int i = 0; i < count; ++i) {
+                    int c = candidates[i];
+                    batchX[2 * i] = c;
+                    batchY[2 * i] = Next(c);
+                    batchX[2 * i + 1] = Prev(c);
+                    batchY[2 * i + 1] = c;
+                }
+                fill(batchFrom.begin(), batchFrom.begin() + total, first);
+                fill(batchTo.begin(), batchTo.begin() + total, last);
+                GatherDistances(dist, batchX.data(), batchFrom.data(), total, batchPlus1.data());
+                GatherDistances(dist, batchTo.data(), batchY.data(), total, batchPlus2.data());
+                GatherDistances(dist, batchX.data(), batchTo.data(), total, batchPlus3.data());
+                GatherDistances(dist, batchFrom.data(), batchY.data(), total, batchPlus4.data());
+                GatherDistances(dist, batchX.data(), batchY.data(), total, batchMinus.data());
+
+                auto valid = [&](int j) {
+                    return !inSegment(candidates[j / 2]) && batchY[j] != p
+                        && !inSegment(batchX[j]) && !inSegment(batchY[j]);
+                };
+                // Первый допустимый ход, улучшающий обход при прямой или обратной вставке
+                auto firstImproving = [&](const int* plus1, const int* plus2) {
+                    int j = FirstNegativeDelta(plus1, plus2, batchMinus.data(), -gain, 0, total);
+                    while (j != -1 && !valid(j)) {
+                        j = FirstNegativeDelta(plus1, plus2, batchMinus.data(), -gain, j + 1, total);
+                    }
+                    return j;
+                };
+                int straightIndex = firstImproving(batchPlus1.data(), batchPlus2.data());
+                int reversedIndex = firstImproving(batchPlus3.data(), batchPlus4.data());
+                if (straightIndex == -1 && reversedIndex == -1) continue;
+
+                int j = straightIndex == -1 ? reversedIndex
+                    : reversedIndex == -1 ? straightIndex
+                    : min(straightIndex, reversedIndex);
+                int x = batchX[j];
+                int y = batchY[j];
+                long long straight = static_cast<long long>(batchPlus1[j]) + batchPlus2[j];
+                long long reversed = static_cast<long long>(batchPlus3[j]) + batchPlus4[j];
+
+                Move(p, first, x, y);
+                Move(p, x, nx, last);
+                if (straight < reversed) Move(x, last, first, y);
+                Activate(p);
+                Activate(nx);
+                Activate(first);
+                Activate(last);
+                Activate(x);
+                Activate(y);
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    LocalSearchSolver(const Distance& dist, int n, int k = 10)
+        : dist(dist), n(n), k(min(k, max(n - 1, 0))), stop(nullptr), moves(0),
+        batchFrom(2 * this->k), batchTo(2 * this->k), batchX(2 * this->k), batchY(2 * this->k),
+        batchAdded(this->k), batchPlus1(2 * this->k), batchPlus2(2 * this->k), batchPlus3(2 * this->k),
+        batchPlus4(2 * this->k), batchMinus(2 * this->k) {}
+
+    // Флаг отмены, проверяемый между ходами локального поиска
+    void SetStopFlag(const atomic<bool>* flag) { stop = flag; }
+
+    // Списки кандидатов полным перебором: O(n^2) для небольших задач.
+    // Строка расстояний считается одним пакетом, сортировка идёт по готовым значениям.
+    void BuildNeighbours() {
+        neighbours.assign(static_cast<size_t>(n) * k, 0);
+        vector<int> order(max(n - 1, 0));
+        vector<int> row(n);
+        for (int i = 0; i < n; ++i) {
+            DistanceRow(dist, i, n, row.data());
+            order.clear();
+            for (int j = 0; j < n; ++j) {
+                if (j != i) order.push_back(j);
+            }
+            partial_sort(order.begin(), order.begin() + k, order.end(),
+                [&row](int a, int b) { return row[a] < row[b]; });
+            copy(order.begin(), order.begin() + k, neighbours.begin() + static_cast<size_t>(i) * k);
+        }
+    }
+
+    // Готовые списки: по k ближайших соседей на город, по возрастанию расстояния
+    void SetNeighbours(vector<int> lists) { neighbours = move(lists); }
+
+    int GetCandidateCount() const { return k; }
+
+    void BuildNearestNeighbourTour() {
+        tour.clear();
+        tour.reserve(n);
+        vector<bool> visited(n, false);
+        // Непосещённые города: обмен с последним при удалении, чтобы не сканировать все n
+        vector<int> remaining(n);
+        vector<int> slot(n);
+        for (int i = 0; i < n; ++i) {
+            remaining[i] = i;
+            slot[i] = i;
+        }
+        auto take = [&](int city) {
+            visited[city] = true;
+            tour.push_back(city);
+            int moved = remaining.back();
+            remaining[slot[city]] = moved;
+            slot[moved] = slot[city];
+            remaining.pop_back();
+        };
+
+        take(0);
+        while (!remaining.empty()) {
+            int current = tour.back();
+            int next = -1;
+            for (int i = 0; i < k; ++i) {
+                int c = neighbours[static_cast<size_t>(current) * k + i];
+                if (!visited[c]) {
+                    next = c;
+                    break;
+                }
+            }
+            if (next == -1) {
+                for (int c : remaining) {
+                    if (next == -1 || dist(current, c) < dist(current, next)) next = c;
+                }
+            }
+            take(next);
+        }
+    }
+
+    void SetTour(const vector<int>& initial) { tour = initial; }
+
+    void Optimize() {
+        pos.assign(n, 0);
+        for (int i = 0; i < n; ++i) pos[tour[i]] = i;
+        if (n < 5 || k == 0) return;
+
+        active.clear();
+        queued.assign(n, false);
+        for (int city : tour) Activate(city);
+
+        while (!active.empty()) {
+            if (stop && stop->load(memory_order_relaxed)) break;
+            int a = active.front();
+            active.pop_front();
+            queued[a] = false;
+            if (TryTwoOpt(a) || TryOrOpt(a)) {
+                ++moves;
+                Activate(a);
+            }
+        }
+    }
+
+    // Обход, начинающийся с города 0
+    vector<int> GetTour() const {
+        vector<int> result = tour;
+        rotate(result.begin(), find(result.begin(), result.end(), 0), result.end());
+        return result;
+    }
+
+    long long GetMoveCount() const { return moves; }
+
+    // Списки кандидатов, обход, очередь и буферы пакетной оценки в байтах
+    size_t GetMemoryBytes() const {
+        size_t ints = neighbours.capacity() + tour.capacity() + pos.capacity() + active.size()
+            + batchFrom.capacity() + batchTo.capacity() + batchX.capacity() + batchY.capacity()
+            + batchAdded.capacity() + batchPlus1.capacity() + batchPlus2.capacity() + batchPlus3.capacity()
+            + batchPlus4.capacity() + batchMinus.capacity();
+        return ints * sizeof(int) + queued.capacity() / 8;
+    }
+
+    long long GetLength() const { return TourLength(dist, tour); }
+};
+
+// initial - необязательный начальный обход (например, прежнее решение после правки весов)
+template <typename Distance>
+vector<int> RunLocalSearch(const Distance& dist, int n, const atomic<bool>* stop, SearchStats* stats,
+    const vector<int>* initial = nullptr) {
+    LocalSearchSolver<Distance> solver(dist, n);
+    solver.SetStopFlag(stop);
+    solver.BuildNeighbours();
+    if (initial && static_cast<int>(initial->size()) == n) solver.SetTour(*initial);
+    else solver.BuildNearestNeighbourTour();
+    solver.Optimize();
+    if (stats) {
+        stats->nodesExpanded = solver.GetMoveCount();
+        stats->Allocate(solver.GetMemoryBytes());
+    }
+    return solver.GetTour();
+}
+
+// По координатам списки кандидатов и "ближайший сосед" берутся из k-d дерева:
+// O(n log n) вместо O(n^2), поэтому десятки тысяч городов решаются без матрицы
+vector<int> RunLocalSearch(const EuclideanDistance& dist, int n, const atomic<bool>* stop, SearchStats* stats,
+    const vector<int>* initial = nullptr) {
+    LocalSearchSolver<EuclideanDistance> solver(dist, n);
+    solver.SetStopFlag(stop);
+    KdTree tree(dist.x, dist.y);
+    solver.SetNeighbours(tree.NeighbourLists(solver.GetCandidateCount()));
+    if (initial && static_cast<int>(initial->size()) == n) {
+        solver.SetTour(*initial);
+    }
+    else {
+        vector<int> tour;
+        tour.reserve(n);
+        int city = 0;
+        while (city != -1) {
+            tour.push_back(city);
+            tree.Remove(city);
+            city = tree.Nearest(dist.x[city], dist.y[city]);
+        }
+        solver.SetTour(tour);
+    }
+    solver.Optimize();
+    if (stats) {
+        stats->nodesExpanded = solver.GetMoveCount();
+        stats->Allocate(solver.GetMemoryBytes());
+    }
+    return solver.GetTour();
+}
+
+// Полный эвристический конвейер на плотной матрице
+pair<vector<int>, int> SolveHeuristic(const vector<int>& cost, int n,
+    const atomic<bool>* stop = nullptr, SearchStats* stats = nullptr, const vector<int>* initial = nullptr) {
+    if (n < 2) return { vector<int>(), INF };
+
+    bool symmetric = true;
+    for (int i = 0; i < n && symmetric; ++i) {
+        for (int j = i + 1; j < n; ++j) {
+            if (cost[static_cast<size_t>(i) * n + j] != cost[static_cast<size_t>(j) * n + i]) {
+                symmetric = false;
+                break;
+            }
+        }
+    }
+
+    vector<int> tour;
+    if (symmetric) {
+        tour = RunLocalSearch(MatrixDistance(cost, n), n, stop, stats, initial);
+    }
+    else {
+        tour = RunLocalSearch(SymmetricDistance(cost, n), n, stop, stats, initial);
+        // Направление обхода выбираем по настоящим весам
+        vector<int> reversed(tour.rbegin(), tour.rend() - 1);
+        reversed.insert(reversed.begin(), 0);
+        if (TourCost(cost, n, reversed) < TourCost(cost, n, tour)) tour = reversed;
+    }
+    return { tour, TourCost(cost, n, tour) };
+}
+
+// Эвристика по координатам без матрицы весов
+pair<vector<int>, int> SolveEuclideanHeuristic(vector<double> x, vector<double> y,
+    const atomic<bool>* stop = nullptr, SearchStats* stats = nullptr) {
+    int n = static_cast<int>(x.size());
+    if (n < 2) return { vector<int>(), INF };
+
+    EuclideanDistance dist(move(x), move(y));
+    vector<int> tour = RunLocalSearch(dist, n, stop, stats);
+    long long length = TourLength(dist, tour);
+    return { tour, length >= INF ? INF : static_cast<int>(length) };
+}
+
+// Динамическое программирование Хелда-Карпа: O(n^2 * 2^n) по времени.
+// Город 0 - всегда старт, поэтому маски перебирают только города 1..n-1,
+// а таблица dp[mask][j] хранится одним плоским массивом строками по маске.
+class HeldKarpSolver {
+private:
+    const vector<int>& cost;
+    int n;
+    const atomic<bool>* stop;
+    mutable long long states;
+
+public:
+    static const int maxCities = 25;
+
+    HeldKarpSolver(const vector<int>& cost, int n) : cost(cost), n(n), stop(nullptr), states(0) {}
+
+    long long GetStateCount() const { return states; }
+
+    // Флаг отмены, проверяемый каждые несколько тысяч масок; при отмене решения нет
+    void SetStopFlag(const atomic<bool>* flag) { stop = flag; }
+
+    // Возвращает порядок обхода в индексах (начиная с 0, без возврата) и стоимость
+    pair<vector<int>, int> Solve() const {
+        if (n < 2 || n > maxCities) return { vector<int>(), INF };
+
+        // Половина INF: сумма двух таких значений не переполняет int,
+        // поэтому во внутреннем цикле не нужны проверки на отсутствие ребра
+        const int HK_INF = INF / 2;
+        const int m = n - 1;
+        const size_t subsets = size_t(1) << m;
+
+        // incoming[j * m + k] - вес ребра (k+1) -> (j+1), строка подряд для внутреннего цикла
+        vector<int> incoming(static_cast<size_t>(m) * m, HK_INF);
+        for (int j = 0; j < m; ++j) {
+            for (int k = 0; k < m; ++k) {
+                int w = cost[static_cast<size_t>(k + 1) * n + (j + 1)];
+                if (k != j && w != INF) incoming[static_cast<size_t>(j) * m + k] = min(w, HK_INF);
+            }
+        }
+
+        vector<int> dp(subsets * m, HK_INF);
+        vector<uint8_t> parent(subsets * m, 0);
+
+        for (int j = 0; j < m; ++j) {
+            int w = cost[j + 1];
+            if (w != INF) dp[(size_t(1) << j) * m + j] = min(w, HK_INF);
+        }
+
+        for (size_t mask = 1; mask < subsets; ++mask) {
+            if ((mask & 4095) == 0 && stop && stop->load(memory_order_relaxed)) return { vector<int>(), INF };
+            if ((mask & (mask - 1)) == 0) continue;
+            int* row = &dp[mask * m];
+            uint8_t* parentRow = &parent[mask * m];
+            for (int j = 0; j < m; ++j) {
+                if (!((mask >> j) & 1)) continue;
+                // Для k вне prev в таблице лежит HK_INF, так что проверка принадлежности не нужна
+                const int* prevRow = &dp[(mask ^ (size_t(1) << j)) * m];
+                const int* in = &incoming[static_cast<size_t>(j) * m];
+                int best = HK_INF;
+                int bestK = 0;
+                for (int k = 0; k < m; ++k) {
+                    int candidate = prevRow[k] + in[k];
+                    if (candidate < best) {
+                        best = candidate;
+                        bestK = k;
+                    }
+                }
+                row[j] = best;
+                ++states;
+                parentRow[j] = static_cast<uint8_t>(bestK);
+            }
+        }
+
+        const size_t full = subsets - 1;
+        int best = HK_INF;
+        int last = -1;
+        for (int j = 0; j < m; ++j) {
+            int w = cost[static_cast<size_t>(j + 1) * n];
+            if (w == INF) continue;
+            int candidate = dp[full * m + j] + min(w, HK_INF);
+            if (candidate < best) {
+                best = candidate;
+                last = j;
+            }
+        }
+        if (last == -1) return { vector<int>(), INF };
+
+        vector<int> path(n);
+        size_t mask = full;
+        for (int pos = n - 1; pos >= 1; --pos) {
+            path[pos] = last + 1;
+            int prev = parent[mask * m + last];
+            mask ^= size_t(1) << last;
+            last = prev;
+        }
+        path[0] = 0;
+        return { path, best };
+    }
+
+    // Объём таблиц dp и parent в байтах
+    static unsigned long long TableBytes(int n) {
+        if (n < 2) return 0;
+        return (1ULL << (n - 1)) * (n - 1) * (sizeof(int) + sizeof(uint8_t));
+    }
+};
+
+// Лимит памяти точного Хелда-Карпа по умолчанию (ключ --memory-mb пакетного режима и замеров)
+unsigned long long heldKarpMemoryBudget = 8ULL << 30;
+
+// Хелд-Карп с экономией памяти для задач крупнее плотной таблицы. Значения dp хранятся
+// только для двух соседних слоёв (масок одного размера) и в узком типе Cost - uint16_t,
+// если это позволяет граница; для всех состояний остаётся лишь байт родителя. Внутри слоя
+// маска нумеруется своим рангом, таблица рангов - 4 байта на маску. Состояние
+// отбрасывается, если стоимость пути плюс нижняя граница остатка (у каждого ещё не
+// покинутого города - самое дешёвое ребро в непосещённый город или в старт, либо
+// минимальные входящие в непосещённые и в старт) не меньше стоимости известного обхода;
+// из отброшенных состояний переходы не считаются.
+template <typename Cost>
+class CompactHeldKarpSolver {
+private:
+    const vector<int>& cost;
+    int n;
+    long long upperBound;
+    const atomic<bool>* stop;
+    SearchStats stats;
+
+    static unsigned long long Binomial(int m, int k) {
+        if (k < 0 || k > m) return 0;
+        unsigned long long result = 1;
+        for (int i = 1; i <= k; ++i) result = result * (m - k + i) / i;
+        return result;
+    }
+
+    // Следующая маска с тем же числом битов; false после последней маски из m битов
+    static bool NextMask(uint32_t& mask, uint32_t full) {
+        if (mask == 0 || mask == full) return false;
+        uint32_t low = mask & (~mask + 1);
+        uint32_t ripple = mask + low;
+        if (ripple == 0 || ripple > full) return false;
+        uint32_t result = ripple | (((mask ^ ripple) >> 2) / low);
+        if (result > full) return false;
+        mask = result;
+        return true;
+    }
+
+public:
+    static const int maxCities = 32;
+
+    // Ищутся только обходы строго дешевле upperBound; он же должен помещаться в Cost
+    CompactHeldKarpSolver(const vector<int>& cost, int n, long long upperBound)
+        : cost(cost), n(n), upperBound(upperBound), stop(nullptr) {}
+
+    void SetStopFlag(const atomic<bool>* flag) { stop = flag; }
+
+    const SearchStats& GetStats() const { return stats; }
+
+    // Родители, ранги масок и два самых больших соседних слоя значений
+    static unsigned long long RequiredBytes(int n) {
+        if (n < 2) return 0;
+        int m = n - 1;
+        unsigned long long masks = 1ULL << m;
+        unsigned long long layers = 0;
+        for (int s = 1; s < m; ++s) layers = max(layers, Binomial(m, s) + Binomial(m, s + 1));
+        return masks * m + masks * sizeof(uint32_t) + layers * m * sizeof(Cost);
+    }
+
+    pair<vector<int>, int> Solve() {
+        stats.Reset(n);
+        if (n < 2 || n > maxCities) return { vector<int>(), INF };
+        const int m = n - 1;
+        const Cost dead = numeric_limits<Cost>::max();
+        const uint32_t full = static_cast<uint32_t>((1ULL << m) - 1);
+
+        // Минимальные исходящие и входящие рёбра для нижней границы
+        vector<long long> minOut(n, INF), minIn(n, INF);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                int w = cost[static_cast<size_t>(i) * n + j];
+                if (i == j || w == INF) continue;
+                minOut[i] = min<long long>(minOut[i], w);
+                minIn[j] = min<long long>(minIn[j], w);
+            }
+        }
+        long long totalIn = 0;
+        for (int i = 0; i < n; ++i) {
+            if (minOut[i] == INF || minIn[i] == INF) return { vector<int>(), INF };
+            if (i != 0) totalIn += minIn[i];
+        }
+
+        // Исходящие рёбра городов 1..n-1 по возрастанию веса (цель 0 - бит m)
+        vector<int> targets(static_cast<size_t>(m) * m);
+        for (int u = 0; u < m; ++u) {
+            int* list = &targets[static_cast<size_t>(u) * m];
+            int count = 0;
+            for (int t = 0; t <= m; ++t) {
+                if (t != u) list[count++] = t;
+            }
+            const int* row = &cost[static_cast<size_t>(u + 1) * n];
+            sort(list, list + m, [row, m](int a, int b) { return row[a == m ? 0 : a + 1] < row[b == m ? 0 : b + 1]; });
+        }
+
+        // Ранг маски среди масок того же размера - номер в порядке возрастания
+        vector<uint32_t> rank(static_cast<size_t>(full) + 1);
+        for (int size = 1; size <= m; ++size) {
+            uint32_t mask = (1u << size) - 1;
+            uint32_t r = 0;
+            do {
+                rank[mask] = r++;
+            } while (NextMask(mask, full));
+        }
+
+        vector<uint8_t> parent((static_cast<size_t>(full) + 1) * m);
+        vector<Cost> current(static_cast<size_t>(m) * m, dead);
+        vector<Cost> next;
+        stats.Allocate(parent.size() + rank.size() * sizeof(uint32_t) + targets.size() * sizeof(int)
+            + current.size() * sizeof(Cost));
+
+        for (int j = 0; j < m; ++j) {
+            int w = cost[j + 1];
+            if (w == INF) continue;
+            long long bound = totalIn - minIn[j + 1] + minIn[0];
+            if (w + bound >= upperBound) {
+                stats.CountPruned(1);
+                continue;
+            }
+            current[static_cast<size_t>(rank[1u << j]) * m + j] = static_cast<Cost>(w);
+            stats.CountExpanded(1);
+        }
+
+        long long steps = 0;
+        vector<long long> limit(m);
+        for (int size = 1; size < m; ++size) {
+            next.assign(static_cast<size_t>(Binomial(m, size + 1)) * m, dead);
+            stats.Allocate(next.size() * sizeof(Cost));
+            long long pruned = 0;
+            uint32_t mask = (1u << size) - 1;
+            do {
+                if ((++steps & 4095) == 0 && stop && stop->load(memory_order_relaxed)) return { vector<int>(), INF };
+                const Cost* values = &current[static_cast<size_t>(rank[mask]) * m];
+                bool limitKnown = false;
+                for (int k = 0; k < m; ++k) {
+                    if (values[k] == dead) continue;
+                    if (!limitKnown) {
+                        // Предел стоимости пути до каждого следующего города - один раз на маску.
+                        // Выход из последнего города уже оплачен ребром в следующий.
+                        // Исходящее ребро непосещённого города ведет в непосещённый или в старт:
+                        // берем первое такое в отсортированном списке
+                        limitKnown = true;
+                        long long restOut = 0, restIn = totalIn;
+                        for (int u = 0; u < m; ++u) {
+                            if ((mask >> u) & 1) {
+                                restIn -= minIn[u + 1];
+                                continue;
+                            }
+                            const int* list = &targets[static_cast<size_t>(u) * m];
+                            int t = 0;
+                            while (list[t] != m && ((mask >> list[t]) & 1)) ++t;
+                            int w = cost[static_cast<size_t>(u + 1) * n + (list[t] == m ? 0 : list[t] + 1)];
+                            // Из города некуда выйти - продолжений нет
+                            restOut += w == INF ? upperBound : w;
+                        }
+                        for (int j = 0; j < m; ++j) {
+                            limit[j] = upperBound - max(restOut, restIn - minIn[j + 1] + minIn[0]);
+                        }
+                    }
+                    const int* row = &cost[static_cast<size_t>(k + 1) * n + 1];
+                    for (int j = 0; j < m; ++j) {
+                        if (((mask >> j) & 1) || row[j] == INF) continue;
+                        long long value = static_cast<long long>(values[k]) + row[j];
+                        if (value >= limit[j]) {
+                            ++pruned;
+                            continue;
+                        }
+                        uint32_t target = mask | (1u << j);
+                        Cost& slot = next[static_cast<size_t>(rank[target]) * m + j];
+                        if (value < slot) {
+                            slot = static_cast<Cost>(value);
+                            parent[static_cast<size_t>(target) * m + j] = static_cast<uint8_t>(k);
+                        }
+                    }
+                }
+            } while (NextMask(mask, full));
+            stats.Release(current.size() * sizeof(Cost));
+            current.swap(next);
+            long long live = 0;
+            for (Cost value : current) live += value != dead;
+            stats.nodesExpanded += live;
+            stats.expandedByDepth[size + 1] = live;
+            stats.nodesPruned += pruned;
+            stats.prunedByDepth[size + 1] = pruned;
+        }
+
+        long long best = upperBound;
+        int last = -1;
+        for (int j = 0; j < m; ++j) {
+            Cost value = current[j];
+            int w = cost[static_cast<size_t>(j + 1) * n];
+            if (value == dead || w == INF) continue;
+            if (value + static_cast<long long>(w) < best) {
+                best = value + static_cast<long long>(w);
+                last = j;
+            }
+        }
+        if (last == -1) return { vector<int>(), INF };
+        stats.RecordIncumbent(static_cast<int>(best));
+
+        vector<int> path(n);
+        uint32_t mask = full;
+        for (int pos = n - 1; pos >= 1; --pos) {
+            path[pos] = last + 1;
+            int prev = parent[static_cast<size_t>(mask) * m + last];
+            mask ^= 1u << last;
+            last = prev;
+        }
+        path[0] = 0;
+        return { path, static_cast<int>(best) };
+    }
+};
+
+// Точный Хелд-Карп в пределах лимита памяти. Плотная таблица быстрее, поэтому берётся,
+// когда помещается; иначе - послойный вариант с отсечением по лучшему из эвристического
+// обхода и "ближайшего соседа" (если дешевле ничего нет, он и есть оптимум).
+// Если не помещается ни то, ни другое - stats->budgetExceeded и пустой результат.
+pair<vector<int>, int> SolveHeldKarp(const vector<int>& cost, int n, unsigned long long budget,
+    const atomic<bool>* stop, SearchStats* stats) {
+    if (n <= HeldKarpSolver::maxCities && HeldKarpSolver::TableBytes(n) <= budget) {
+        HeldKarpSolver solver(cost, n);
+        solver.SetStopFlag(stop);
+        auto result = solver.Solve();
+        stats->nodesExpanded = solver.GetStateCount();
+        stats->Allocate(HeldKarpSolver::TableBytes(n));
+        return result;
+    }
+    if (n > CompactHeldKarpSolver<int>::maxCities) return { vector<int>(), INF };
+
+    // На несимметричной матрице 2-opt по симметризованным весам бывает далёк от оптимума
+    auto heuristic = SolveHeuristic(cost, n, stop);
+    auto greedy = NearestNeighbourTour(cost, n);
+    if (greedy.second < heuristic.second) heuristic = greedy;
+    long long bound = heuristic.second;
+    bool narrow = bound <= numeric_limits<uint16_t>::max();
+    unsigned long long required = narrow ? CompactHeldKarpSolver<uint16_t>::RequiredBytes(n)
+        : CompactHeldKarpSolver<uint32_t>::RequiredBytes(n);
+    // В 32-битной сборке адресное пространство - тоже лимит
+    if (required > budget || required > numeric_limits<size_t>::max() / 2) {
+        stats->budgetExceeded = true;
+        return { vector<int>(), INF };
+    }
+
+    pair<vector<int>, int> result;
+    if (narrow) {
+        CompactHeldKarpSolver<uint16_t> solver(cost, n, bound);
+        solver.SetStopFlag(stop);
+        result = solver.Solve();
+        *stats = solver.GetStats();
+    }
+    else {
+        CompactHeldKarpSolver<uint32_t> solver(cost, n, bound);
+        solver.SetStopFlag(stop);
+        result = solver.Solve();
+        *stats = solver.GetStats();
+    }
+    if (stop && stop->load()) return { vector<int>(), INF };
+    if (result.first.empty() && heuristic.second != INF) return heuristic;
+    return result;
+}
+
+// Пул потоков с собственной очередью у каждого потока: владелец берёт задачи
+// с конца своей очереди (в глубину), простаивающие потоки воруют с начала чужих.
+template <typename Task>
+class WorkStealingPool {
+private:
+    struct Queue {
+        mutex lock;
+        deque<Task> tasks;
+    };
+
+    vector<unique_ptr<Queue>> queues;
+    // Задачи в очередях плюс выполняемые сейчас; пул завершается, когда счётчик обнулится
+    atomic<long long> pending;
+
+    bool Pop(int worker, Task& task) {
+        Queue& queue = *queues[worker];
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.tasks.empty()) return false;
+        task = move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool Steal(int thief, Task& task) {
+        int count = static_cast<int>(queues.size());
+        for (int i = 1; i < count; ++i) {
+            Queue& queue = *queues[(thief + i) % count];
+            lock_guard<mutex> guard(queue.lock);
+            if (queue.tasks.empty()) continue;
+            task = move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+public:
+    explicit WorkStealingPool(int threads) : pending(0) {
+        for (int i = 0; i < max(threads, 1); ++i) {
+            queues.emplace_back(new Queue());
+        }
+    }
+
+    int Size() const { return static_cast<int>(queues.size()); }
+
+    void Push(int worker, Task task) {
+        pending.fetch_add(1);
+        Queue& queue = *queues[worker];
+        lock_guard<mutex> guard(queue.lock);
+        queue.tasks.push_back(move(task));
+    }
+
+    // Выполняет fn(task, worker) для всех задач, в том числе добавленных из самих задач
+    template <typename Fn>
+    void Run(Fn fn) {
+        auto work = [this, &fn](int worker) {
+            Task task;
+            while (pending.load() > 0) {
+                if (Pop(worker, task) || Steal(worker, task)) {
+                    fn(task, worker);
+                    pending.fetch_sub(1);
+                }
+                else {
+                    this_thread::yield();
+                }
+            }
+        };
+
+        vector<thread> threads;
+        for (int i = 1; i < Size(); ++i) threads.emplace_back(work, i);
+        work(0);
+        for (thread& t : threads) t.join();
+    }
+};
+
+// Метод ветвей и границ с редуцированной матрицей (Литтл). Ветвление - продление пути
+// из города 0; нижняя граница узла - стоимость пути плюс сумма констант приведения
+// строк и столбцов. Дети обходятся в порядке возрастания границы, начальная
+// верхняя граница берётся из обхода "ближайший сосед".
+// Среди оптимальных обходов всегда выбирается лексикографически наименьший, поэтому
+// последовательный и параллельный поиск возвращают один и тот же маршрут.
+class BranchAndBoundSolver {
+private:
+    struct Child {
+        vector<int> matrix;
+        long long bound;
+        int city;
+    };
+
+    // Подзадача для пула: префикс пути с уже приведённой матрицей
+    struct Task {
+        vector<int> matrix;
+        long long bound;
+        long long pathCost;
+        vector<int> path;
+    };
+
+    const vector<int>& cost;
+    int n;
+    vector<int> bestPath;
+    atomic<int> bestCost;
+    mutex bestLock;
+    SearchStats stats;          // рекорды - под bestLock, счётчики потоков - под statsLock
+    mutex statsLock;
+    vector<int> initialTour;
+    int upperBound;
+    const atomic<bool>* stop;
+    function<void(const vector<int>&, int)> observer;
+    // Матрицы открытых узлов всех потоков; максимум переносится в stats.peakMemoryBytes
+    atomic<size_t> openBytes;
+    atomic<size_t> peakOpenBytes;
+
+    pair<vector<int>, int> Result() {
+        stats.peakMemoryBytes = peakOpenBytes.load();
+        if (bestPath.empty()) return { vector<int>(), INF };
+        return { bestPath, bestCost.load() };
+    }
+
+    size_t NodeBytes() const { return static_cast<size_t>(n) * n * sizeof(int); }
+
+    void OpenNodes(size_t count) {
+        size_t now = openBytes.fetch_add(count * NodeBytes(), memory_order_relaxed) + count * NodeBytes();
+        size_t peak = peakOpenBytes.load(memory_order_relaxed);
+        while (peak < now && !peakOpenBytes.compare_exchange_weak(peak, now, memory_order_relaxed)) {}
+    }
+
+    void CloseNodes(size_t count) { openBytes.fetch_sub(count * NodeBytes(), memory_order_relaxed); }
+
+    bool Stopped() const { return stop && stop->load(memory_order_relaxed); }
+
+    // Приводит активные строки (текущий и непосещённые города) и столбцы (непосещённые и 0).
+    // Возвращает сумму вычтенных констант или -1, если из какой-то строки/в какой-то столбец нет ребра.
+    long long Reduce(vector<int>& matrix, const vector<bool>& visited, int current) const {
+        long long total = 0;
+        for (int i = 0; i < n; ++i) {
+            if (visited[i] && i != current) continue;
+            int* row = &matrix[static_cast<size_t>(i) * n];
+            int rowMin = INF;
+            for (int j = 0; j < n; ++j) rowMin = min(rowMin, row[j]);
+            if (rowMin == INF) return -1;
+            if (rowMin == 0) continue;
+            for (int j = 0; j < n; ++j) {
+                if (row[j] != INF) row[j] -= rowMin;
+            }
+            total += rowMin;
+        }
+        for (int j = 0; j < n; ++j) {
+            if (visited[j] && j != 0) continue;
+            int colMin = INF;
+            for (int i = 0; i < n; ++i) colMin = min(colMin, matrix[static_cast<size_t>(i) * n + j]);
+            if (colMin == INF) return -1;
+            if (colMin == 0) continue;
+            for (int i = 0; i < n; ++i) {
+                int& w = matrix[static_cast<size_t>(i) * n + j];
+                if (w != INF) w -= colMin;
+            }
+            total += colMin;
+        }
+        return total;
+    }
+
+    // Дети узла с границей не хуже рекорда, по возрастанию границы
+    vector<Child> Branch(const vector<int>& matrix, long long bound, int current,
+        vector<bool>& visited, int depth, SearchStats& local) const {
+        bool last = depth == n - 1;
+        vector<Child> children;
+        for (int j = 0; j < n; ++j) {
+            int edge = matrix[static_cast<size_t>(current) * n + j];
+            if (visited[j] || edge == INF) continue;
+
+            Child child;
+            child.matrix = matrix;
+            child.city = j;
+            int* m = child.matrix.data();
+            for (int k = 0; k < n; ++k) {
+                m[static_cast<size_t>(current) * n + k] = INF;
+                m[static_cast<size_t>(k) * n + j] = INF;
+            }
+            // Запрещаем преждевременное возвращение в старт
+            if (!last) m[static_cast<size_t>(j) * n] = INF;
+
+            visited[j] = true;
+            long long reduction = Reduce(child.matrix, visited, j);
+            visited[j] = false;
+            if (reduction < 0) continue;
+
+            child.bound = bound + edge + reduction;
+            if (child.bound <= bestCost.load(memory_order_relaxed)) children.push_back(move(child));
+            else local.CountPruned(depth + 1);
+        }
+
+        sort(children.begin(), children.end(),
+            [](const Child& a, const Child& b) { return a.bound < b.bound; });
+        return children;
+    }
+
+    // Узел отсекается, если граница хуже рекорда, или равна ему, а префикс пути
+    // лексикографически больше префикса рекорда (меньшего обхода в поддереве нет)
+    bool Prune(long long bound, const vector<int>& path) {
+        int best = bestCost.load(memory_order_relaxed);
+        if (bound != best) return bound > best;
+
+        lock_guard<mutex> guard(bestLock);
+        best = bestCost.load(memory_order_relaxed);
+        if (bound != best) return bound > best;
+        if (bestPath.empty()) return true;
+        return lexicographical_compare(bestPath.begin(), bestPath.begin() + path.size(),
+            path.begin(), path.end());
+    }
+
+    void Offer(const vector<int>& path, long long total) {
+        if (total >= INF || total > bestCost.load(memory_order_relaxed)) return;
+
+        lock_guard<mutex> guard(bestLock);
+        int best = bestCost.load(memory_order_relaxed);
+        if (total < best || (total == best && path < bestPath)) {
+            bestPath = path;
+            bestCost.store(static_cast<int>(total));
+            stats.RecordIncumbent(static_cast<int>(total));
+            if (observer) observer(bestPath, static_cast<int>(total));
+        }
+    }
+
+    void Search(const vector<int>& matrix, long long bound, int current, long long pathCost,
+        vector<bool>& visited, vector<int>& path, SearchStats& local) {
+        if (Stopped()) return;
+        int depth = static_cast<int>(path.size());
+        local.CountExpanded(depth);
+
+        if (static_cast<int>(path.size()) == n) {
+            int returnCost = cost[static_cast<size_t>(current) * n];
+            if (returnCost != INF) Offer(path, pathCost + returnCost);
+            return;
+        }
+
+        vector<Child> children = Branch(matrix, bound, current, visited, depth, local);
+        OpenNodes(children.size());
+        for (const Child& child : children) {
+            path.push_back(child.city);
+            if (!Prune(child.bound, path)) {
+                visited[child.city] = true;
+                Search(child.matrix, child.bound, child.city,
+                    pathCost + cost[static_cast<size_t>(current) * n + child.city], visited, path, local);
+                visited[child.city] = false;
+            }
+            else {
+                local.CountPruned(depth + 1);
+            }
+            path.pop_back();
+        }
+        CloseNodes(children.size());
+    }
+
+    // Начальный рекорд и корень дерева; false, если обхода заведомо нет
+    bool Initialize(vector<int>& root, long long& bound) {
+        stats.Reset(n + 1);
+        auto initial = NearestNeighbourTour(cost, n);
+        int initialCost = TourCost(cost, n, initialTour);
+        if (initialCost < initial.second) {
+            initial.first = initialTour;
+            initial.second = initialCost;
+        }
+        bestPath = initial.first;
+        bestCost = initial.second;
+        if (upperBound < bestCost.load()) {
+            // Ищем только обходы строго дешевле известной границы
+            bestPath.clear();
+            bestCost = upperBound;
+        }
+        if (!bestPath.empty()) stats.RecordIncumbent(bestCost.load());
+        if (observer && !bestPath.empty()) observer(bestPath, bestCost.load());
+
+        root = cost;
+        for (int i = 0; i < n; ++i) root[static_cast<size_t>(i) * n + i] = INF;
+        vector<bool> visited(n, false);
+        visited[0] = true;
+        bound = Reduce(root, visited, 0);
+        return bound >= 0;
+    }
+
+public:
+    BranchAndBoundSolver(const vector<int>& cost, int n)
+        : cost(cost), n(n), bestCost(INF), upperBound(INF), stop(nullptr), openBytes(0), peakOpenBytes(0) {}
+
+    // Начальный рекорд (обход с городом 0 в начале), если он лучше "ближайшего соседа"
+    void SetInitialTour(const vector<int>& tour) { initialTour = tour; }
+
+    // Граница без обхода: ищутся только обходы строго дешевле, иначе результат пустой
+    void SetUpperBound(int bound) { upperBound = bound; }
+
+    // Флаг отмены: поиск сворачивается и возвращает лучший найденный обход
+    void SetStopFlag(const atomic<bool>* flag) { stop = flag; }
+
+    // Вызывается при каждом улучшении рекорда (из рабочего потока, под блокировкой рекорда)
+    void SetObserver(function<void(const vector<int>&, int)> callback) { observer = move(callback); }
+
+    long long GetExpandedNodes() const { return stats.nodesExpanded; }
+
+    const SearchStats& GetStats() const { return stats; }
+
+    pair<vector<int>, int> Solve() {
+        if (n < 2) return { vector<int>(), INF };
+
+        vector<int> root;
+        long long bound;
+        OpenNodes(1);
+        if (Initialize(root, bound)) {
+            vector<bool> visited(n, false);
+            visited[0] = true;
+            vector<int> path;
+            path.reserve(n);
+            path.push_back(0);
+            Search(root, bound, 0, 0, visited, path, stats);
+        }
+        return Result();
+    }
+
+    // Параллельный поиск: верхние уровни дерева дробятся на подзадачи по префиксам пути,
+    // поддеревья ниже splitDepth обходятся последовательно. Рекорд общий для всех потоков.
+    pair<vector<int>, int> SolveParallel(int threads) {
+        if (n < 4 || threads <= 1) return Solve();
+
+        vector<int> root;
+        long long bound;
+        OpenNodes(1);
+        if (!Initialize(root, bound)) return Result();
+
+        // Дробим, пока подзадач заведомо не станет в десятки раз больше, чем потоков
+        int splitDepth = 1;
+        long long tasks = 1;
+        while (splitDepth < n - 2 && tasks < 64LL * threads) {
+            tasks *= n - splitDepth;
+            ++splitDepth;
+        }
+
+        WorkStealingPool<Task> pool(threads);
+        Task rootTask;
+        rootTask.matrix = move(root);
+        rootTask.bound = bound;
+        rootTask.pathCost = 0;
+        rootTask.path.push_back(0);
+        pool.Push(0, move(rootTask));
+
+        pool.Run([this, &pool, splitDepth](Task& task, int worker) {
+            // Матрица задачи учтена при постановке в очередь и живёт до конца обработки
+            if (Stopped()) {
+                CloseNodes(1);
+                return;
+            }
+            int depth = static_cast<int>(task.path.size());
+            if (Prune(task.bound, task.path)) {
+                CloseNodes(1);
+                lock_guard<mutex> guard(statsLock);
+                stats.CountPruned(depth);
+                return;
+            }
+
+            vector<bool> visited(n, false);
+            for (int city : task.path) visited[city] = true;
+            int current = task.path.back();
+            SearchStats local;
+
+            if (depth < splitDepth) {
+                local.CountExpanded(depth);
+                vector<Child> children = Branch(task.matrix, task.bound, current, visited, depth, local);
+                OpenNodes(children.size());
+                // Лучший ребёнок кладётся последним, чтобы владелец взял его первым
+                for (auto it = children.rbegin(); it != children.rend(); ++it) {
+                    Task child;
+                    child.matrix = move(it->matrix);
+                    child.bound = it->bound;
+                    child.pathCost = task.pathCost + cost[static_cast<size_t>(current) * n + it->city];
+                    child.path = task.path;
+                    child.path.push_back(it->city);
+                    pool.Push(worker, move(child));
+                }
+            }
+            else {
+                Search(task.matrix, task.bound, current, task.pathCost, visited, task.path, local);
+            }
+            CloseNodes(1);
+            lock_guard<mutex> guard(statsLock);
+            stats.Merge(local);
+        });
+
+        return Result();
+    }
+};
+
+// Ветви и границы для несимметричной задачи (Карпането-Тот). Нижняя граница узла -
+// решение задачи о назначениях венгерским методом: каждый город получает ровно одного
+// преемника, но допускаются подциклы. Если назначение - один цикл, это обход.
+// Иначе ветвимся по кратчайшему подциклу с дугами e1..ek: k-й ребёнок запрещает ek и
+// фиксирует e1..e(k-1). Запреты только увеличивают стоимости, поэтому потенциалы
+// родителя остаются допустимыми и ребёнок пересчитывается за O(n^2) на строку.
+class AssignmentBranchAndBoundSolver {
+private:
+    struct Node {
+        vector<int> matrix;
+        vector<long long> u, v;
+        vector<int> p;          // p[j] - строка, назначенная столбцу j (с единицы, 0 - нет)
+        vector<int> next, prev; // зафиксированные дуги, -1 - нет
+        long long bound;
+    };
+
+    const vector<int>& cost;
+    int n;
+    long long forbidden;
+    vector<int> bestPath;
+    int bestCost;
+    SearchStats stats;
+    vector<int> initialTour;
+    int upperBound;
+    const atomic<bool>* stop;
+    function<void(const vector<int>&, int)> observer;
+
+    bool Stopped() const { return stop && stop->load(memory_order_relaxed); }
+
+    long long At(const Node& node, int i, int j) const {
+        int w = node.matrix[static_cast<size_t>(i) * n + j];
+        return w == INF ? forbidden : w;
+    }
+
+    // Одна фаза венгерского метода: назначает строку row (с нуля) по кратчайшему
+    // увеличивающему пути, сохраняя допустимость потенциалов
+    void Augment(Node& node, int row) {
+        vector<long long> minv(n + 1, numeric_limits<long long>::max());
+        vector<int> way(n + 1, 0);
+        vector<char> used(n + 1, 0);
+        vector<long long>& u = node.u;
+        vector<long long>& v = node.v;
+        vector<int>& p = node.p;
+
+        p[0] = row + 1;
+        int j0 = 0;
+        do {
+            used[j0] = 1;
+            int i0 = p[j0];
+            long long delta = numeric_limits<long long>::max();
+            int j1 = 0;
+            for (int j = 1; j <= n; ++j) {
+                if (used[j]) continue;
+                long long cur = At(node, i0 - 1, j - 1) - u[i0] - v[j];
+                if (cur < minv[j]) {
+                    minv[j] = cur;
+                    way[j] = j0;
+                }
+                if (minv[j] < delta) {
+                    delta = minv[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= n; ++j) {
+                if (used[j]) {
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                }
+                else {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+
+        do {
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+
+    // Снимает назначения с запрещённых клеток, достраивает назначение и считает границу
+    void Repair(Node& node) {
+        vector<int> freeRows;
+        for (int j = 1; j <= n; ++j) {
+            int i = node.p[j];
+            if (i != 0 && node.matrix[static_cast<size_t>(i - 1) * n + (j - 1)] == INF) {
+                node.p[j] = 0;
+                freeRows.push_back(i - 1);
+            }
+        }
+        for (int row : freeRows) Augment(node, row);
+
+        node.bound = 0;
+        for (int j = 1; j <= n; ++j) node.bound += At(node, node.p[j] - 1, j - 1);
+    }
+
+    // Матрица, потенциалы, назначение и цепочки одного узла
+    size_t NodeBytes() const {
+        return static_cast<size_t>(n) * n * sizeof(int) + 2 * (n + 1) * sizeof(long long)
+            + (n + 1) * sizeof(int) + 2 * n * sizeof(int);
+    }
+
+    void Forbid(Node& node, int i, int j) {
+        node.matrix[static_cast<size_t>(i) * n + j] = INF;
+    }
+
+    // Фиксирует дугу i -> j и запрещает дугу, замыкающую цепочку в преждевременный цикл
+    void Include(Node& node, int i, int j) {
+        for (int k = 0; k < n; ++k) {
+            if (k != j) Forbid(node, i, k);
+            if (k != i) Forbid(node, k, j);
+        }
+        node.next[i] = j;
+        node.prev[j] = i;
+
+        int head = i, tail = j, length = 2;
+        while (node.prev[head] != -1) {
+            head = node.prev[head];
+            ++length;
+        }
+        while (node.next[tail] != -1) {
+            tail = node.next[tail];
+            ++length;
+        }
+        if (length < n) Forbid(node, tail, head);
+    }
+
+    // Преемник каждого города по текущему назначению
+    vector<int> Successors(const Node& node) const {
+        vector<int> succ(n);
+        for (int j = 1; j <= n; ++j) succ[node.p[j] - 1] = j - 1;
+        return succ;
+    }
+
+    void Offer(const vector<int>& succ, long long total) {
+        if (total >= bestCost) return;
+        vector<int> path;
+        int city = 0;
+        do {
+            path.push_back(city);
+            city = succ[city];
+        } while (city != 0);
+        bestPath = path;
+        bestCost = static_cast<int>(total);
+        stats.RecordIncumbent(bestCost);
+        if (observer) observer(bestPath, bestCost);
+    }
+
+    // depth - число ветвлений от корня
+    void Search(Node& node, int depth) {
+        if (Stopped()) return;
+        stats.CountExpanded(depth);
+
+        // Подцикл с наименьшим числом незафиксированных дуг
+        vector<int> succ = Successors(node);
+        vector<char> seen(n, 0);
+        vector<pair<int, int>> branchArcs;
+        bool first = true;
+        for (int start = 0; start < n; ++start) {
+            if (seen[start]) continue;
+            vector<pair<int, int>> arcs;
+            int length = 0;
+            int city = start;
+            do {
+                seen[city] = 1;
+                ++length;
+                if (node.next[city] == -1) arcs.emplace_back(city, succ[city]);
+                city = succ[city];
+            } while (city != start);
+
+            if (length == n) {
+                Offer(succ, node.bound);
+                return;
+            }
+            if (first || arcs.size() < branchArcs.size()) {
+                branchArcs = move(arcs);
+                first = false;
+            }
+        }
+
+        vector<Node> children;
+        for (size_t k = 0; k < branchArcs.size(); ++k) {
+            Node child = node;
+            for (size_t t = 0; t < k; ++t) Include(child, branchArcs[t].first, branchArcs[t].second);
+            Forbid(child, branchArcs[k].first, branchArcs[k].second);
+            Repair(child);
+            if (child.bound >= forbidden) continue;
+            if (child.bound < bestCost) children.push_back(move(child));
+            else stats.CountPruned(depth + 1);
+        }
+
+        sort(children.begin(), children.end(),
+            [](const Node& a, const Node& b) { return a.bound < b.bound; });
+        stats.Allocate(children.size() * NodeBytes());
+        for (size_t k = 0; k < children.size(); ++k) {
+            if (children[k].bound >= bestCost) {
+                stats.CountPruned(depth + 1, static_cast<long long>(children.size() - k));
+                break;
+            }
+            Search(children[k], depth + 1);
+        }
+        stats.Release(children.size() * NodeBytes());
+    }
+
+public:
+    AssignmentBranchAndBoundSolver(const vector<int>& cost, int n)
+        : cost(cost), n(n), forbidden(1), bestCost(INF), upperBound(INF), stop(nullptr) {}
+
+    // Начальный рекорд (обход с городом 0 в начале), если он лучше "ближайшего соседа"
+    void SetInitialTour(const vector<int>& tour) { initialTour = tour; }
+
+    // Граница без обхода: ищутся только обходы строго дешевле, иначе результат пустой
+    void SetUpperBound(int bound) { upperBound = bound; }
+
+    void SetStopFlag(const atomic<bool>* flag) { stop = flag; }
+
+    // Вызывается при каждом улучшении рекорда из потока поиска
+    void SetObserver(function<void(const vector<int>&, int)> callback) { observer = move(callback); }
+
+    long long GetExpandedNodes() const { return stats.nodesExpanded; }
+
+    const SearchStats& GetStats() const { return stats; }
+
+    pair<vector<int>, int> Solve() {
+        if (n < 2) return { vector<int>(), INF };
+
+        stats.Reset(n + 1);
+        auto initial = NearestNeighbourTour(cost, n);
+        int initialCost = TourCost(cost, n, initialTour);
+        if (initialCost < initial.second) {
+            initial.first = initialTour;
+            initial.second = initialCost;
+        }
+        bestPath = initial.first;
+        bestCost = initial.second;
+        if (upperBound < bestCost) {
+            bestPath.clear();
+            bestCost = upperBound;
+        }
+        if (!bestPath.empty()) stats.RecordIncumbent(bestCost);
+        if (observer && !bestPath.empty()) observer(bestPath, bestCost);
+
+        // Запрещённая клетка дороже любого допустимого назначения
+        int maxWeight = 0;
+        for (int w : cost) {
+            if (w != INF) maxWeight = max(maxWeight, w);
+        }
+        forbidden = static_cast<long long>(maxWeight) * n + 1;
+
+        Node root;
+        stats.Allocate(NodeBytes());
+        root.matrix = cost;
+        for (int i = 0; i < n; ++i) root.matrix[static_cast<size_t>(i) * n + i] = INF;
+        root.u.assign(n + 1, 0);
+        root.v.assign(n + 1, 0);
+        root.p.assign(n + 1, 0);
+        root.next.assign(n, -1);
+        root.prev.assign(n, -1);
+        for (int i = 0; i < n; ++i) Augment(root, i);
+        Repair(root);
+
+        if (root.bound < forbidden && root.bound < bestCost) Search(root, 0);
+        if (bestPath.empty()) return { vector<int>(), INF };
+        return { bestPath, bestCost };
+    }
+};
+
+// Полный перебор перестановок с отсечением по текущей стоимости пути
+class ExhaustiveSolver {
+private:
+    const vector<int>& cost;
+    int n;
+    SearchStats stats;
+    int upperBound;
+    const atomic<bool>* stop;
+
+    void TSPRec(int current_pos, int count, int current_cost,
+        vector<bool>& visited, vector<int>& current_path,
+        vector<int>& final_path, int& final_cost) {
+        if (stop && stop->load(memory_order_relaxed)) return;
+        stats.CountExpanded(count);
+        if (count == n) {
+            int return_cost = cost[static_cast<size_t>(current_path.back()) * n + current_path[0]];
+            if (return_cost != INF) {
+                int total_cost = current_cost + return_cost;
+                if (total_cost < final_cost) {
+                    final_cost = total_cost;
+                    final_path = current_path;
+                    stats.RecordIncumbent(final_cost);
+                }
+            }
+            return;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int w = cost[static_cast<size_t>(current_pos) * n + i];
+            if (!visited[i] && w != INF) {
+                int new_cost = current_cost + w;
+                if (new_cost < final_cost) {
+                    visited[i] = true;
+                    current_path.push_back(i);
+
+                    TSPRec(i, count + 1, new_cost, visited, current_path, final_path, final_cost);
+
+                    visited[i] = false;
+                    current_path.pop_back();
+                }
+                else {
+                    stats.CountPruned(count + 1);
+                }
+            }
+        }
+    }
+
+public:
+    ExhaustiveSolver(const vector<int>& cost, int n)
+        : cost(cost), n(n), upperBound(INF), stop(nullptr) {}
+
+    void SetStopFlag(const atomic<bool>* flag) { stop = flag; }
+
+    // Ищутся только обходы строго дешевле границы, иначе результат пустой
+    void SetUpperBound(int bound) { upperBound = bound; }
+
+    long long GetExpandedNodes() const { return stats.nodesExpanded; }
+
+    const SearchStats& GetStats() const { return stats; }
+
+    pair<vector<int>, int> Solve() {
+        vector<int> path;
+        int min_path = upperBound;
+        stats.Reset(n + 1);
+        if (n < 2) return { path, INF };
+
+        vector<bool> visited(n, false);
+        vector<int> current_path;
+        current_path.push_back(0);
+        visited[0] = true;
+        // Текущий и лучший путь; стек рекурсии не учитывается
+        stats.Allocate(2 * static_cast<size_t>(n) * sizeof(int) + (n + 7) / 8);
+
+        TSPRec(0, 1, 0, visited, current_path, path, min_path);
+        if (path.empty()) return { path, INF };
+        return { path, min_path };
+    }
+};
+
+// Точный перебор для фиксированного числа городов N: маска посещённых в uint32_t, путь
+// и матрица в std::array, глубина рекурсии - параметр шаблона, поэтому циклы по городам
+// разворачиваются при компиляции. Соседи перебираются по возрастанию веса; граница узла -
+// стоимость пути плюс минимальные исходящие рёбра всех ещё не покинутых городов.
+template <int N>
+class FixedSizeSolver {
+private:
+    array<int, N * N> weight;
+    array<array<int, N - 1>, N> order;
+    array<long long, N> minOut;
+    array<int, N> path;
+    array<int, N> bestPath;
+    long long bestCost;
+    // Счётчики по глубине в массивах, в SearchStats переносятся после поиска
+    array<long long, N + 1> expanded;
+    array<long long, N + 1> pruned;
+    SearchStats stats;
+
+    template <int Depth>
+    void Search(uint32_t visited, int current, long long pathCost, long long remainingMin) {
+        ++expanded[Depth];
+        if constexpr (Depth == N) {
+            int back = weight[current * N];
+            if (back != INF && pathCost + back < bestCost) {
+                bestCost = pathCost + back;
+                bestPath = path;
+                stats.RecordIncumbent(static_cast<int>(bestCost));
+            }
+        }
+        else {
+            int open = N - Depth; // непосещённые соседи, ещё не взятые в поиск
+            for (int k = 0; k < N - 1; ++k) {
+                int next = order[current][k];
+                int w = weight[current * N + next];
+                if (w == INF) break;
+                // Соседи отсортированы: дальше граница только растёт
+                if (pathCost + w + remainingMin >= bestCost) {
+                    pruned[Depth + 1] += open;
+                    break;
+                }
+                if (visited & (1u << next)) continue;
+
+                --open;
+                path[Depth] = next;
+                Search<Depth + 1>(visited | (1u << next), next, pathCost + w, remainingMin - minOut[next]);
+            }
+        }
+    }
+
+public:
+    FixedSizeSolver() : bestCost(INF) {}
+
+    long long GetExpandedNodes() const { return stats.nodesExpanded; }
+
+    const SearchStats& GetStats() const { return stats; }
+
+    // Ищутся только обходы строго дешевле upperBound; иначе результат пустой
+    pair<vector<int>, int> Solve(const vector<int>& cost, int upperBound = INF) {
+        long long remainingMin = 0;
+        for (int i = 0; i < N; ++i) {
+            int k = 0;
+            for (int j = 0; j < N; ++j) {
+                weight[i * N + j] = i == j ? INF : cost[static_cast<size_t>(i) * N + j];
+                if (j != i) order[i][k++] = j;
+            }
+            sort(order[i].begin(), order[i].end(),
+                [this, i](int a, int b) { return weight[i * N + a] < weight[i * N + b]; });
+            minOut[i] = weight[i * N + order[i][0]];
+            if (minOut[i] == INF) return { vector<int>(), INF };
+            if (i != 0) remainingMin += minOut[i];
+        }
+
+        bestCost = upperBound;
+        stats.Reset(N + 1);
+        // Всё состояние поиска - поля решателя фиксированного размера
+        stats.Allocate(sizeof(*this));
+        expanded.fill(0);
+        pruned.fill(0);
+        path[0] = 0;
+        Search<1>(1u, 0, 0, remainingMin);
+        for (int d = 0; d <= N; ++d) {
+            stats.nodesExpanded += expanded[d];
+            stats.nodesPruned += pruned[d];
+            stats.expandedByDepth[d] = expanded[d];
+            stats.prunedByDepth[d] = pruned[d];
+        }
+        if (bestCost >= upperBound) return { vector<int>(), INF };
+        return { vector<int>(bestPath.begin(), bestPath.end()), static_cast<int>(bestCost) };
+    }
+};
+
+template <int N>
+pair<vector<int>, int> SolveFixedSize(const vector<int>& cost, int upperBound, SearchStats& stats) {
+    FixedSizeSolver<N> solver;
+    auto result = solver.Solve(cost, upperBound);
+    stats = solver.GetStats();
+    return result;
+}
+
+// Выбор специализации по числу городов во время выполнения; false - размер не поддержан
+bool SolveSmallInstance(const vector<int>& cost, int n, int upperBound,
+    pair<vector<int>, int>& result, SearchStats& stats) {
+    switch (n) {
+    case 6: result = SolveFixedSize<6>(cost, upperBound, stats); return true;
+    case 7: result = SolveFixedSize<7>(cost, upperBound, stats); return true;
+    case 8: result = SolveFixedSize<8>(cost, upperBound, stats); return true;
+    case 9: result = SolveFixedSize<9>(cost, upperBound, stats); return true;
+    case 10: result = SolveFixedSize<10>(cost, upperBound, stats); return true;
+    case 11: result = SolveFixedSize<11>(cost, upperBound, stats); return true;
+    case 12: result = SolveFixedSize<12>(cost, upperBound, stats); return true;
+    default: return false;
+    }
+}
+
+// Тёплый старт: известный обход (для эвристики - начальный, для точных методов - рекорд)
+// и строгая верхняя граница стоимости без обхода
+struct WarmStart {
+    vector<int> tour;
+    int upperBound;
+
+    WarmStart() : upperBound(INF) {}
+};
+
+// Решение на плотной матрице выбранным методом; обход в индексах начинается с города 0
+// stop - необязательный флаг отмены; после отмены возвращается лучший найденный обход.
+// С границей warm->upperBound точные методы возвращают пустой обход, если дешевле нет.
+pair<vector<int>, int> SolveTSPMatrix(const vector<int>& cost, int n, TSPMethod method,
+    SearchStats* stats = nullptr, const atomic<bool>* stop = nullptr, const WarmStart* warm = nullptr) {
+    SearchStats local;
+    if (!stats) stats = &local;
+    *stats = SearchStats();
+    WarmStart none;
+    if (!warm) warm = &none;
+
+    pair<vector<int>, int> result;
+    switch (method) {
+    case TSPMethod::HeldKarp:
+        result = SolveHeldKarp(cost, n, heldKarpMemoryBudget, stop, stats);
+        break;
+    case TSPMethod::BranchAndBound:
+    case TSPMethod::ParallelBranchAndBound: {
+        BranchAndBoundSolver solver(cost, n);
+        solver.SetStopFlag(stop);
+        solver.SetInitialTour(warm->tour);
+        solver.SetUpperBound(warm->upperBound);
+        result = method == TSPMethod::BranchAndBound
+            ? solver.Solve()
+            : solver.SolveParallel(static_cast<int>(thread::hardware_concurrency()));
+        *stats = solver.GetStats();
+        break;
+    }
+    case TSPMethod::AssignmentBranchAndBound: {
+        AssignmentBranchAndBoundSolver solver(cost, n);
+        solver.SetStopFlag(stop);
+        solver.SetInitialTour(warm->tour);
+        solver.SetUpperBound(warm->upperBound);
+        result = solver.Solve();
+        *stats = solver.GetStats();
+        break;
+    }
+    case TSPMethod::Heuristic:
+        result = SolveHeuristic(cost, n, stop, stats, warm->tour.empty() ? nullptr : &warm->tour);
+        break;
+    default: {
+        // Перебор отсекает по стоимости, поэтому известный обход служит начальной границей.
+        // Для 6-12 городов - специализация под размер, иначе общий перебор.
+        int tourCost = TourCost(cost, n, warm->tour);
+        int bound = min(warm->upperBound, tourCost);
+        if (!SolveSmallInstance(cost, n, bound, result, *stats)) {
+            ExhaustiveSolver solver(cost, n);
+            solver.SetStopFlag(stop);
+            solver.SetUpperBound(bound);
+            result = solver.Solve();
+            *stats = solver.GetStats();
+        }
+        if (result.first.empty() && tourCost < warm->upperBound) result = { warm->tour, tourCost };
+        break;
+    }
+    }
+
+    if (result.second >= warm->upperBound) return { vector<int>(), INF };
+    return result;
+}
+
+// Задача в формате TSPLIB: координаты (EUC_2D, GEO) или явная матрица (EXPLICIT)
+struct TSPInstance {
+    string name;
+    string type;
+    string edgeWeightType;
+    string edgeWeightFormat;
+    int dimension;
+    vector<double> x;
+    vector<double> y;
+    vector<int> weights;
+
+    TSPInstance() : dimension(0) {}
+
+    bool HasCoordinates() const { return edgeWeightType != "EXPLICIT"; }
+
+    int Distance(int i, int j) const {
+        if (i == j) return 0;
+        if (edgeWeightType == "EXPLICIT") return weights[static_cast<size_t>(i) * dimension + j];
+        if (edgeWeightType == "GEO") {
+            // Формула TSPLIB: координаты в формате ГГ.ММ, радиус Земли 6378.388 км
+            const double pi = 3.141592;
+            const double rrr = 6378.388;
+            auto radians = [pi](double value) {
+                double degrees = static_cast<int>(value);
+                return pi * (degrees + 5.0 * (value - degrees) / 3.0) / 180.0;
+            };
+            double latI = radians(x[i]), lonI = radians(y[i]);
+            double latJ = radians(x[j]), lonJ = radians(y[j]);
+            double q1 = cos(lonI - lonJ);
+            double q2 = cos(latI - latJ);
+            double q3 = cos(latI + latJ);
+            return static_cast<int>(rrr * acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0);
+        }
+        double dx = x[i] - x[j];
+        double dy = y[i] - y[j];
+        return static_cast<int>(sqrt(dx * dx + dy * dy) + 0.5);
+    }
+
+    vector<int> BuildCostMatrix() const {
+        if (edgeWeightType == "EXPLICIT") return weights;
+        vector<int> cost(static_cast<size_t>(dimension) * dimension);
+        for (int i = 0; i < dimension; ++i) {
+            for (int j = 0; j < dimension; ++j) {
+                cost[static_cast<size_t>(i) * dimension + j] = Distance(i, j);
+            }
+        }
+        return cost;
+    }
+};
+
+// Потоковый разбор файла TSPLIB: заголовок "КЛЮЧ : ЗНАЧЕНИЕ", затем секции
+// NODE_COORD_SECTION или EDGE_WEIGHT_SECTION (FULL_MATRIX, UPPER_ROW)
+bool LoadTSPLIB(const string& path, TSPInstance& instance, string& error) {
+    ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    vector<char> buffer(1 << 20);
+    in.rdbuf()->pubsetbuf(buffer.data(), static_cast<streamsize>(buffer.size()));
+
+    instance = TSPInstance();
+    string line;
+    while (getline(in, line)) {
+        size_t colon = line.find(':');
+        string key = line.substr(0, colon);
+        string value = colon == string::npos ? "" : line.substr(colon + 1);
+        key.erase(remove_if(key.begin(), key.end(),
+            [](char c) { return isspace(static_cast<unsigned char>(c)) != 0; }), key.end());
+        value.erase(0, value.find_first_not_of(" \t\r"));
+        value.erase(value.find_last_not_of(" \t\r") + 1);
+
+        if (key == "NAME") instance.name = value;
+        else if (key == "TYPE") instance.type = value;
+        else if (key == "DIMENSION") instance.dimension = atoi(value.c_str());
+        else if (key == "EDGE_WEIGHT_TYPE") instance.edgeWeightType = value;
+        else if (key == "EDGE_WEIGHT_FORMAT") instance.edgeWeightFormat = value;
+        else if (key == "NODE_COORD_SECTION") {
+            if (instance.edgeWeightType != "EUC_2D" && instance.edgeWeightType != "GEO") {
+                error = "unsupported EDGE_WEIGHT_TYPE " + instance.edgeWeightType;
+                return false;
+            }
+            int n = instance.dimension;
+            instance.x.assign(n, 0.0);
+            instance.y.assign(n, 0.0);
+            for (int k = 0; k < n; ++k) {
+                int id;
+                double px, py;
+                if (!(in >> id >> px >> py) || id < 1 || id > n) {
+                    error = "bad NODE_COORD_SECTION";
+                    return false;
+                }
+                instance.x[id - 1] = px;
+                instance.y[id - 1] = py;
+            }
+        }
+        else if (key == "EDGE_WEIGHT_SECTION") {
+            int n = instance.dimension;
+            bool full = instance.edgeWeightFormat == "FULL_MATRIX";
+            if (instance.edgeWeightType != "EXPLICIT" || (!full && instance.edgeWeightFormat != "UPPER_ROW")) {
+                error = "unsupported EDGE_WEIGHT_FORMAT " + instance.edgeWeightFormat;
+                return false;
+            }
+            instance.weights.assign(static_cast<size_t>(n) * n, 0);
+            for (int i = 0; i < n; ++i) {
+                for (int j = full ? 0 : i + 1; j < n; ++j) {
+                    int w;
+                    if (!(in >> w)) {
+                        error = "truncated EDGE_WEIGHT_SECTION";
+                        return false;
+                    }
+                    instance.weights[static_cast<size_t>(i) * n + j] = i == j ? 0 : w;
+                    if (!full) instance.weights[static_cast<size_t>(j) * n + i] = w;
+                }
+            }
+        }
+        else if (key == "EOF") break;
+    }
+
+    if (instance.dimension < 1) {
+        error = "missing DIMENSION";
+        return false;
+    }
+    if (instance.HasCoordinates() ? instance.x.empty() : instance.weights.empty()) {
+        error = "no node data";
+        return false;
+    }
+    return true;
+}
+
+// Аллокатор с выравниванием блока по границе Alignment байт
+template <typename T, size_t Alignment>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() {}
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t count) {
+        // Исходный указатель хранится прямо перед выровненным блоком
+        void* raw = ::operator new(count * sizeof(T) + Alignment + sizeof(void*));
+        uintptr_t start = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+        uintptr_t aligned = (start + Alignment - 1) & ~static_cast<uintptr_t>(Alignment - 1);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<T*>(aligned);
+    }
+
+    void deallocate(T* block, size_t) {
+        ::operator delete(reinterpret_cast<void**>(block)[-1]);
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+// Квадратная матрица весов, растущая вместе с графом. Строки лежат подряд, шаг строки
+// кратен линии кэша (16 int), сам блок выровнен на 64 байта. Ёмкость удваивается,
+// поэтому добавление вершины в среднем стоит O(n).
+class AdjacencyMatrix {
+private:
+    static const size_t lineInts = 16;
+
+    vector<int, AlignedAllocator<int, 64>> cells;
+    size_t size;
+    size_t stride;
+
+public:
+    AdjacencyMatrix() : size(0), stride(0) {}
+
+    size_t Size() const { return size; }
+    size_t Stride() const { return stride; }
+
+    int* operator[](size_t row) { return cells.data() + row * stride; }
+    const int* operator[](size_t row) const { return cells.data() + row * stride; }
+
+    // Новые строки и столбцы заполняются как у пустого графа: 0 на диагонали, иначе INF
+    void Resize(size_t newSize) {
+        if (newSize > stride) {
+            size_t newStride = stride == 0 ? lineInts : stride * 2;
+            while (newStride < newSize) newStride *= 2;
+            vector<int, AlignedAllocator<int, 64>> grown(newStride * newStride, INF);
+            for (size_t i = 0; i < size; ++i) {
+                copy(cells.begin() + i * stride, cells.begin() + i * stride + size,
+                    grown.begin() + i * newStride);
+            }
+            cells.swap(grown);
+            stride = newStride;
+        }
+        for (size_t i = size; i < newSize; ++i) {
+            for (size_t j = 0; j < newSize; ++j) {
+                (*this)[i][j] = INF;
+                (*this)[j][i] = INF;
+            }
+            (*this)[i][i] = 0;
+        }
+        size = newSize;
+    }
+
+    // Удаление строки и столбца со сдвигом остальных: O(n^2)
+    void Erase(size_t pos) {
+        for (size_t i = 0; i < size; ++i) {
+            int* row = (*this)[i];
+            copy(row + pos + 1, row + size, row + pos);
+        }
+        for (size_t i = pos; i + 1 < size; ++i) {
+            copy((*this)[i + 1], (*this)[i + 1] + size - 1, (*this)[i]);
+        }
+        --size;
+    }
+
+    // Удаление переносом последней строки и столбца на место удаляемых: O(n)
+    void SwapRemove(size_t pos) {
+        size_t last = size - 1;
+        if (pos != last) {
+            copy((*this)[last], (*this)[last] + size, (*this)[pos]);
+            for (size_t i = 0; i < size; ++i) (*this)[i][pos] = (*this)[i][last];
+        }
+        --size;
+    }
+};
+
+// Кэш решений для повторяющихся задач. Ключ - канонический вид задачи: вершины по
+// возрастанию идентификаторов и матрица весов в этом порядке, плюс признак точного
+// решения. В памяти - LRU на capacity задач; если задан каталог, решения ещё и пишутся
+// в него по файлу на задачу и переживают перезапуск программы.
+class SolutionCache {
+public:
+    struct Key {
+        bool exact;
+        vector<int> ids;
+        vector<int> weights;
+        uint64_t hash;
+    };
+
+    // ids[i] - идентификатор вершины i, cost - матрица в том же порядке
+    static Key MakeKey(const vector<int>& ids, const vector<int>& cost, bool exact) {
+        size_t n = ids.size();
+        vector<size_t> order(n);
+        for (size_t i = 0; i < n; ++i) order[i] = i;
+        sort(order.begin(), order.end(), [&ids](size_t a, size_t b) { return ids[a] < ids[b]; });
+
+        Key key;
+        key.exact = exact;
+        key.ids.reserve(n);
+        key.weights.reserve(n * n);
+        for (size_t i : order) {
+            key.ids.push_back(ids[i]);
+            for (size_t j : order) key.weights.push_back(cost[i * n + j]);
+        }
+
+        // FNV-1a по всем полям ключа
+        uint64_t hash = 14695981039346656037ULL;
+        auto mix = [&hash](uint32_t value) {
+            for (int byte = 0; byte < 4; ++byte) {
+                hash ^= (value >> (8 * byte)) & 0xFF;
+                hash *= 1099511628211ULL;
+            }
+        };
+        mix(exact ? 1 : 0);
+        mix(static_cast<uint32_t>(n));
+        for (int id : key.ids) mix(static_cast<uint32_t>(id));
+        for (int w : key.weights) mix(static_cast<uint32_t>(w));
+        key.hash = hash;
+        return key;
+    }
+
+private:
+    struct Entry {
+        Key key;
+        vector<int> tour;
+        int cost;
+    };
+
+    // Индекс по указателю на ключ записи списка: хэш - только корзина, совпадение
+    // проверяется по всему ключу, поэтому коллизия не подменит чужой обход
+    struct KeyHash {
+        size_t operator()(const Key* key) const { return static_cast<size_t>(key->hash); }
+    };
+    struct KeyEqual {
+        bool operator()(const Key* a, const Key* b) const { return SameKey(*a, *b); }
+    };
+
+    size_t capacity;
+    string directory;
+    list<Entry> entries; // от недавно использованных к давним
+    unordered_map<const Key*, list<Entry>::iterator, KeyHash, KeyEqual> index;
+    long long memoryHits;
+    long long diskHits;
+    long long misses;
+
+    static bool SameKey(const Key& a, const Key& b) {
+        return a.exact == b.exact && a.ids == b.ids && a.weights == b.weights;
+    }
+
+    string FilePath(uint64_t hash) const {
+        stringstream name;
+        name << hex << hash << ".sol";
+        return (filesystem::path(directory) / name.str()).string();
+    }
+
+    void Remember(const Key& key, const vector<int>& tour, int cost) {
+        auto it = index.find(&key);
+        if (it != index.end()) {
+            list<Entry>::iterator entry = it->second;
+            index.erase(it);
+            entries.erase(entry);
+        }
+        entries.push_front({ key, tour, cost });
+        index[&entries.front().key] = entries.begin();
+        if (entries.size() > capacity) {
+            index.erase(&entries.back().key);
+            entries.pop_back();
+        }
+    }
+
+    // Файл: строка "exact n", затем идентификаторы, матрица (-1 вместо INF), стоимость и обход
+    bool LoadFromDisk(const Key& key, vector<int>& tour, int& cost) const {
+        ifstream in(FilePath(key.hash));
+        if (!in) return false;
+
+        Key stored;
+        int exact = 0;
+        size_t n = 0;
+        if (!(in >> exact >> n) || n != key.ids.size()) return false;
+        stored.exact = exact != 0;
+        stored.ids.resize(n);
+        stored.weights.resize(n * n);
+        for (int& id : stored.ids) in >> id;
+        for (int& w : stored.weights) {
+            in >> w;
+            if (w < 0) w = INF;
+        }
+        size_t length = 0;
+        // Сохраняются только найденные обходы; файл без полного обхода не используется
+        if (!(in >> cost >> length) || length != n) return false;
+        if (cost < 0) cost = INF;
+        tour.resize(length);
+        for (int& id : tour) in >> id;
+        return static_cast<bool>(in) && SameKey(stored, key);
+    }
+
+    void SaveToDisk(const Key& key, const vector<int>& tour, int cost) const {
+        error_code error;
+        filesystem::create_directories(directory, error);
+        ofstream out(FilePath(key.hash));
+        if (!out) return;
+
+        out << (key.exact ? 1 : 0) << " " << key.ids.size() << "\n";
+        for (size_t i = 0; i < key.ids.size(); ++i) out << (i ? " " : "") << key.ids[i];
+        out << "\n";
+        for (size_t i = 0; i < key.weights.size(); ++i) {
+            out << (i % key.ids.size() ? " " : "") << (key.weights[i] == INF ? -1 : key.weights[i]);
+            if ((i + 1) % key.ids.size() == 0) out << "\n";
+        }
+        out << (cost == INF ? -1 : cost) << " " << tour.size() << "\n";
+        for (size_t i = 0; i < tour.size(); ++i) out << (i ? " " : "") << tour[i];
+        out << "\n";
+    }
+
+public:
+    explicit SolutionCache(size_t capacity = 128)
+        : capacity(max<size_t>(capacity, 1)), memoryHits(0), diskHits(0), misses(0) {}
+
+    // Каталог для решений на диске; пустая строка отключает диск
+    void SetDirectory(const string& path) { directory = path; }
+
+    // tour - обход в идентификаторах вершин без повтора старта
+    bool Lookup(const Key& key, vector<int>& tour, int& cost) {
+        auto it = index.find(&key);
+        if (it != index.end()) {
+            entries.splice(entries.begin(), entries, it->second);
+            tour = it->second->tour;
+            cost = it->second->cost;
+            ++memoryHits;
+            return true;
+        }
+        if (!directory.empty() && LoadFromDisk(key, tour, cost)) {
+            Remember(key, tour, cost);
+            ++diskHits;
+            return true;
+        }
+        ++misses;
+        return false;
+    }
+
+    // Вызывающий сохраняет только найденные обходы: неудача (лимит памяти, отмена)
+    // при следующем вызове может обернуться успехом
+    void Store(const Key& key, const vector<int>& tour, int cost) {
+        Remember(key, tour, cost);
+        if (!directory.empty()) SaveToDisk(key, tour, cost);
+    }
+
+    long long GetMemoryHits() const { return memoryHits; }
+    long long GetDiskHits() const { return diskHits; }
+    long long GetMisses() const { return misses; }
+};
+
 class Graph {
 private:
     vector<int> vertList;
-    int adjMatrix[maxSize][maxSize];
+    AdjacencyMatrix adjMatrix;
+    unordered_map<int, int> vertIndex;
     int nextVertexId;
+    bool directed;
 
-public:
-    Graph() : nextVertexId(1) {
-        for (int i = 0; i < maxSize; ++i) {
-            for (int j = 0; j < maxSize; ++j) {
-                adjMatrix[i][j] = (i == j) ? 0 : INF;
-            }
+    // Тёплый старт: последний оптимальный обход (идентификаторы, без повтора старта)
+    // и веса изменённых после него ячеек на момент решения
+    struct EdgeEdit {
+        int from;
+        int to;
+        int oldWeight;
+    };
+    vector<int> solvedTour;
+    vector<EdgeEdit> edits;
+    SolutionCache* cache;
+
+    void RecordEdit(int pos1, int pos2) {
+        if (!solvedTour.empty()) edits.push_back({ vertList[pos1], vertList[pos2], adjMatrix[pos1][pos2] });
+    }
+
+    void SetWeight(int pos1, int pos2, int weight) {
+        RecordEdit(pos1, pos2);
+        adjMatrix[pos1][pos2] = weight;
+        if (!directed) {
+            RecordEdit(pos2, pos1);
+            adjMatrix[pos2][pos1] = weight;
         }
     }
 
-    int GetVertPos(int vertex) const {
-        for (size_t i = 0; i < vertList.size(); ++i) {
-            if (vertList[i] == vertex) {
-                return static_cast<int>(i);
+    // Изменился набор вершин - прежний обход больше не подходит
+    void ForgetSolution() {
+        solvedTour.clear();
+        edits.clear();
+    }
+
+    // Повторное решение после правок весов. Прежний оптимальный обход T остаётся
+    // оптимальным, если подешевели только его рёбра, а подорожали только чужие. Если
+    // вдобавок подешевело одно чужое ребро (u, v), дешевле T может быть лишь обход через
+    // (u, v); если подорожало одно ребро T - лишь обход без него. Тогда ищем только среди
+    // таких обходов с T как верхней границей. Иначе - полный поиск с T (починенным
+    // эвристикой, если в нём пропало ребро) в качестве рекорда.
+    pair<vector<int>, int> Resolve(const vector<int>& cost, int n, TSPMethod method, SearchStats* stats) {
+        vector<int> tour;
+        for (int id : solvedTour) tour.push_back(GetVertPos(id));
+        rotate(tour.begin(), find(tour.begin(), tour.end(), 0), tour.end());
+        int tourCost = TourCost(cost, n, tour);
+
+        vector<int> next(n);
+        for (int i = 0; i < n; ++i) next[tour[i]] = tour[(i + 1) % n];
+
+        // На симметричной матрице ребро (i, j) и (j, i) - одно и то же ребро обхода
+        bool symmetric = true;
+        for (int i = 0; i < n && symmetric; ++i) {
+            for (int j = i + 1; j < n; ++j) {
+                if (cost[static_cast<size_t>(i) * n + j] != cost[static_cast<size_t>(j) * n + i]) {
+                    symmetric = false;
+                    break;
+                }
+            }
+        }
+
+        bool uncertain = false;
+        vector<pair<int, int>> improving;
+        vector<pair<int, int>> worse;
+        for (size_t e = 0; e < edits.size(); ++e) {
+            int i = GetVertPos(edits[e].from);
+            int j = GetVertPos(edits[e].to);
+            if (symmetric && i > j) swap(i, j);
+
+            // Вес на момент решения - в первой записи по ячейке (ребру)
+            bool seen = false;
+            for (size_t f = 0; f < e && !seen; ++f) {
+                int a = GetVertPos(edits[f].from);
+                int b = GetVertPos(edits[f].to);
+                if (symmetric && a > b) swap(a, b);
+                seen = a == i && b == j;
+            }
+            if (seen) continue;
+
+            int oldWeight = edits[e].oldWeight;
+            int weight = cost[static_cast<size_t>(i) * n + j];
+            if (symmetric) {
+                // До правок ребро могло быть несимметричным - тогда гарантий нет
+                int reverseOld = cost[static_cast<size_t>(j) * n + i];
+                for (size_t f = 0; f < edits.size(); ++f) {
+                    if (GetVertPos(edits[f].from) == j && GetVertPos(edits[f].to) == i) {
+                        reverseOld = edits[f].oldWeight;
+                        break;
+                    }
+                }
+                if (reverseOld != oldWeight) uncertain = true;
+            }
+            if (weight == oldWeight) continue;
+
+            bool used = next[i] == j || (symmetric && next[j] == i);
+            if (used && weight > oldWeight) worse.emplace_back(i, j);
+            else if (!used && weight < oldWeight) improving.emplace_back(i, j);
+        }
+
+        if (!uncertain && worse.empty() && improving.empty()) return { tour, tourCost };
+
+        WarmStart warm;
+        bool onlyImproving = improving.size() == 1 && worse.empty();
+        bool onlyWorse = worse.size() == 1 && improving.empty();
+        if (!uncertain && (onlyImproving || onlyWorse) && tourCost != INF) {
+            vector<int> restricted = cost;
+            if (onlyImproving) {
+                // Фиксируем дугу u -> v; на симметричной матрице обход через v -> u - тот же обход наоборот
+                int u = improving[0].first;
+                int v = improving[0].second;
+                for (int k = 0; k < n; ++k) {
+                    if (k != v) restricted[static_cast<size_t>(u) * n + k] = INF;
+                    if (k != u) restricted[static_cast<size_t>(k) * n + v] = INF;
+                }
             }
+            else {
+                int u = worse[0].first;
+                int v = worse[0].second;
+                restricted[static_cast<size_t>(u) * n + v] = INF;
+                if (symmetric) restricted[static_cast<size_t>(v) * n + u] = INF;
+            }
+            warm.upperBound = tourCost;
+            auto result = SolveTSPMatrix(restricted, n, method, stats, nullptr, &warm);
+            if (result.first.empty()) return { tour, tourCost };
+            return result;
+        }
+
+        warm.tour = tour;
+        if (tourCost == INF) {
+            auto repaired = SolveHeuristic(cost, n, nullptr, nullptr, &tour);
+            warm.tour = repaired.second != INF ? repaired.first : vector<int>();
         }
-        return -1;
+        return SolveTSPMatrix(cost, n, method, stats, nullptr, &warm);
     }
 
-    bool IsEmpty() const {
-        return vertList.empty();
+public:
+    Graph() : nextVertexId(1), directed(false), cache(nullptr) {}
+
+    // Необязательный кэш решений перед SolveTSP; принадлежит вызывающему
+    void SetCache(SolutionCache* solutionCache) { cache = solutionCache; }
+
+    // В ориентированном режиме ребро задаёт только направление vertex1 -> vertex2
+    // (односторонние улицы); уже внесённые веса при переключении не меняются
+    void SetDirected(bool value) { directed = value; }
+
+    bool IsDirected() const { return directed; }
+
+    int GetVertPos(int vertex) const {
+        auto it = vertIndex.find(vertex);
+        return it == vertIndex.end() ? -1 : it->second;
     }
 
-    bool IsFull() const {
-        return vertList.size() == maxSize;
+    bool IsEmpty() const {
+        return vertList.empty();
     }
 
     size_t GetAmountVerts() const {
@@ -59,29 +2797,27 @@ public:
     }
 
     void InsertVertex(int vertex) {
-        if (!IsFull()) {
-            vertList.push_back(vertex);
-            if (vertex >= nextVertexId) {
-                nextVertexId = vertex + 1;
-            }
+        if (GetVertPos(vertex) != -1) return;
+        ForgetSolution();
+        vertIndex[vertex] = static_cast<int>(vertList.size());
+        vertList.push_back(vertex);
+        adjMatrix.Resize(vertList.size());
+        if (vertex >= nextVertexId) {
+            nextVertexId = vertex + 1;
         }
     }
 
     int AddVertexAtPosition(float x, float y) {
-        if (!IsFull()) {
-            int newId = nextVertexId++;
-            vertList.push_back(newId);
-            return newId;
-        }
-        return -1;
+        int newId = nextVertexId;
+        InsertVertex(newId);
+        return newId;
     }
 
     void InsertEdge(int vertex1, int vertex2, int weight) {
         int vertPos1 = GetVertPos(vertex1);
         int vertPos2 = GetVertPos(vertex2);
         if (vertPos1 != -1 && vertPos2 != -1) {
-            adjMatrix[vertPos1][vertPos2] = weight;
-            adjMatrix[vertPos2][vertPos1] = weight;
+            SetWeight(vertPos1, vertPos2, weight);
         }
     }
 
@@ -89,8 +2825,7 @@ public:
         int vertPos1 = GetVertPos(vertex1);
         int vertPos2 = GetVertPos(vertex2);
         if (vertPos1 != -1 && vertPos2 != -1) {
-            adjMatrix[vertPos1][vertPos2] = newWeight;
-            adjMatrix[vertPos2][vertPos1] = newWeight;
+            SetWeight(vertPos1, vertPos2, newWeight);
         }
     }
 
@@ -98,8 +2833,7 @@ public:
         int vertPos1 = GetVertPos(vertex1);
         int vertPos2 = GetVertPos(vertex2);
         if (vertPos1 != -1 && vertPos2 != -1) {
-            adjMatrix[vertPos1][vertPos2] = INF;
-            adjMatrix[vertPos2][vertPos1] = INF;
+            SetWeight(vertPos1, vertPos2, INF);
         }
     }
 
@@ -112,101 +2846,381 @@ public:
         return INF;
     }
 
-    void RemoveVertex(int vertexId) {
-        int pos = GetVertPos(vertexId);
-        if (pos != -1) {
-            vertList.erase(vertList.begin() + pos);
+    // По умолчанию на место удалённой вершины переносится последняя (O(n), порядок
+    // вершин меняется); preserveOrder сдвигает все следующие вершины за O(n^2)
+    void RemoveVertex(int vertexId, bool preserveOrder = false) {
+        int pos = GetVertPos(vertexId);
+        if (pos == -1) return;
+
+        ForgetSolution();
+        vertIndex.erase(vertexId);
+        if (preserveOrder) {
+            vertList.erase(vertList.begin() + pos);
+            adjMatrix.Erase(pos);
+            for (size_t i = pos; i < vertList.size(); ++i) {
+                vertIndex[vertList[i]] = static_cast<int>(i);
+            }
+        }
+        else {
+            adjMatrix.SwapRemove(pos);
+            if (pos != static_cast<int>(vertList.size()) - 1) {
+                vertList[pos] = vertList.back();
+                vertIndex[vertList[pos]] = pos;
+            }
+            vertList.pop_back();
+        }
+    }
+
+    // Пакетное удаление: O(k * n) для k вершин
+    void RemoveVertices(const vector<int>& vertexIds) {
+        for (int vertexId : vertexIds) RemoveVertex(vertexId);
+    }
+
+    void Print() const {
+        cout << "Матрица смежности:\n   ";
+        for (int v : vertList) cout << v << " ";
+        cout << endl;
+        for (size_t i = 0; i < vertList.size(); ++i) {
+            cout << vertList[i] << ": ";
+            for (size_t j = 0; j < vertList.size(); ++j) {
+                if (adjMatrix[i][j] == INF) cout << "INF ";
+                else cout << adjMatrix[i][j] << " ";
+            }
+            cout << endl;
+        }
+    }
+
+    // Плотная копия матрицы n x n (строки подряд) для решателей
+    vector<int> GetCostMatrix() const {
+        size_t n = vertList.size();
+        vector<int> cost(n * n);
+        for (size_t i = 0; i < n; ++i) {
+            copy(adjMatrix[i], adjMatrix[i] + n, cost.begin() + i * n);
+        }
+        return cost;
+    }
+
+    // stats - счётчики поиска; при попадании в кэш или без повторного поиска остаются нулевыми
+    pair<vector<int>, int> SolveTSP(TSPMethod method = TSPMethod::Exhaustive, SearchStats* stats = nullptr) {
+        vector<int> path;
+        int min_path = INF;
+        if (stats) *stats = SearchStats();
+
+        if (vertList.size() < 2) return { path, 0 };
+
+        int n = static_cast<int>(vertList.size());
+        vector<int> cost = GetCostMatrix();
+        bool exact = method != TSPMethod::Heuristic;
+        pair<vector<int>, int> result;
+        SolutionCache::Key key;
+        vector<int> cachedTour;
+        if (cache) key = SolutionCache::MakeKey(vertList, cost, exact);
+        if (cache && cache->Lookup(key, cachedTour, result.second)) {
+            for (int id : cachedTour) result.first.push_back(GetVertPos(id));
+            rotate(result.first.begin(), find(result.first.begin(), result.first.end(), 0), result.first.end());
+        }
+        else {
+            // Эвристика всегда решает с нуля, чтобы её разрыв с оптимумом оставался честным
+            bool warm = exact && !solvedTour.empty();
+            SearchStats local;
+            if (!stats) stats = &local;
+            result = warm ? Resolve(cost, n, method, stats) : SolveTSPMatrix(cost, n, method, stats);
+            if (cache && !result.first.empty() && !stats->budgetExceeded) {
+                for (int idx : result.first) cachedTour.push_back(vertList[idx]);
+                cache->Store(key, cachedTour, result.second);
+            }
+        }
+        path = result.first;
+        min_path = result.second;
+
+        if (exact) {
+            ForgetSolution();
+            for (int idx : path) solvedTour.push_back(vertList[idx]);
+        }
+
+        vector<int> result_path;
+        for (int idx : path) {
+            result_path.push_back(vertList[idx]);
+        }
+        result_path.push_back(vertList[0]);
+
+        return { result_path, min_path };
+    }
+
+    const vector<int>& getVertices() const { return vertList; }
+    const AdjacencyMatrix& getAdjMatrix() const { return adjMatrix; }
+};
+
+// Текущий лучший маршрут фонового поиска (в идентификаторах вершин, замкнутый)
+struct TSPSnapshot {
+    vector<int> path;
+    int cost;
+    bool optimal;
+};
+
+// Фоновый поиск "в любой момент": сначала эвристика (миллисекунды), затем точный метод,
+// каждое улучшение публикуется. Публикация без блокировок: рабочий поток создаёт новый
+// неизменяемый снимок и подменяет атомарный указатель; старые снимки живут до следующего
+// запуска, поэтому отрисовка может читать указатель в любой момент.
+class AsyncTSPSolver {
+private:
+    thread worker;
+    atomic<bool> cancelRequested;
+    atomic<bool> running;
+    atomic<const TSPSnapshot*> latest;
+    vector<unique_ptr<TSPSnapshot>> published;
+
+    void Publish(const vector<int>& ids, const vector<int>& order, int cost, bool optimal) {
+        unique_ptr<TSPSnapshot> snapshot(new TSPSnapshot());
+        for (int idx : order) snapshot->path.push_back(ids[idx]);
+        if (!order.empty()) snapshot->path.push_back(ids[order[0]]);
+        snapshot->cost = cost;
+        snapshot->optimal = optimal;
+        latest.store(snapshot.get(), memory_order_release);
+        published.push_back(move(snapshot));
+    }
+
+    void Run(vector<int> cost, vector<int> ids, TSPMethod method) {
+        int n = static_cast<int>(ids.size());
+        vector<int> bestOrder;
+        int bestCost = INF;
+        auto improve = [&](const vector<int>& order, int c) {
+            if (c < bestCost) {
+                bestCost = c;
+                bestOrder = order;
+                Publish(ids, bestOrder, bestCost, false);
+            }
+        };
+
+        auto heuristic = SolveHeuristic(cost, n, &cancelRequested);
+        improve(heuristic.first, heuristic.second);
+
+        if (method == TSPMethod::HeldKarp && !cancelRequested.load()) {
+            SearchStats stats;
+            auto result = SolveHeldKarp(cost, n, heldKarpMemoryBudget, &cancelRequested, &stats);
+            improve(result.first, result.second);
+        }
+        else if (method == TSPMethod::AssignmentBranchAndBound && !cancelRequested.load()) {
+            AssignmentBranchAndBoundSolver solver(cost, n);
+            solver.SetInitialTour(bestOrder);
+            solver.SetStopFlag(&cancelRequested);
+            solver.SetObserver(improve);
+            solver.Solve();
+        }
+        else if (method != TSPMethod::Heuristic && !cancelRequested.load()) {
+            // Полный перебор в фоне заменяется методом ветвей и границ
+            BranchAndBoundSolver solver(cost, n);
+            solver.SetInitialTour(bestOrder);
+            solver.SetStopFlag(&cancelRequested);
+            solver.SetObserver(improve);
+            if (method == TSPMethod::BranchAndBound) solver.Solve();
+            else solver.SolveParallel(static_cast<int>(thread::hardware_concurrency()));
+        }
+
+        bool optimal = method != TSPMethod::Heuristic && !cancelRequested.load();
+        Publish(ids, bestOrder, bestCost, optimal);
+        running.store(false);
+    }
+
+public:
+    AsyncTSPSolver() : cancelRequested(false), running(false), latest(nullptr) {}
+
+    ~AsyncTSPSolver() { Cancel(); }
+
+    void Start(vector<int> cost, vector<int> ids, TSPMethod method) {
+        Cancel();
+        published.clear();
+        latest.store(nullptr);
+        if (ids.size() < 2) return;
+
+        cancelRequested.store(false);
+        running.store(true);
+        worker = thread(&AsyncTSPSolver::Run, this, move(cost), move(ids), method);
+    }
+
+    void Cancel() {
+        cancelRequested.store(true);
+        if (worker.joinable()) worker.join();
+    }
 
-            for (int i = pos; i < static_cast<int>(vertList.size()); ++i) {
-                for (int j = 0; j < maxSize; ++j) {
-                    adjMatrix[i][j] = adjMatrix[i + 1][j];
-                }
-            }
+    bool IsRunning() const { return running.load(); }
 
-            for (int j = pos; j < static_cast<int>(vertList.size()); ++j) {
-                for (int i = 0; i < maxSize; ++i) {
-                    adjMatrix[i][j] = adjMatrix[i][j + 1];
-                }
-            }
+    // Последний опубликованный снимок или nullptr; действителен до следующего Start
+    const TSPSnapshot* Latest() const { return latest.load(memory_order_acquire); }
+};
 
-            for (int i = 0; i < maxSize; ++i) {
-                adjMatrix[static_cast<int>(vertList.size())][i] = INF;
-                adjMatrix[i][static_cast<int>(vertList.size())] = INF;
-            }
-        }
+// Равномерная сетка по координатам вершин для поиска по клику и по прямоугольнику.
+// Ячейка со стороной cellSize хранит номера своих вершин; запрос обходит только ячейки,
+// задетые областью, поэтому стоит O(1 + найденных), пока вершины не свалены в одну ячейку.
+// Пустые ячейки не хранятся, так что координаты не ограничены окном.
+class SpatialGrid {
+private:
+    float cellSize;
+    unordered_map<long long, vector<int>> cells;
+    vector<pair<float, float>> positions;  // по номеру вершины
+    vector<bool> present;
+
+    int CellCoord(float v) const { return static_cast<int>(floor(v / cellSize)); }
+
+    static long long CellKey(int cx, int cy) {
+        return static_cast<long long>(cx) << 32 | static_cast<unsigned>(cy);
     }
 
-    void Print() const {
-        cout << "Матрица смежности:\n   ";
-        for (int v : vertList) cout << v << " ";
-        cout << endl;
-        for (size_t i = 0; i < vertList.size(); ++i) {
-            cout << vertList[i] << ": ";
-            for (size_t j = 0; j < vertList.size(); ++j) {
-                if (adjMatrix[i][j] == INF) cout << "INF ";
-                else cout << adjMatrix[i][j] << " ";
+    // visit(id) для всех вершин из ячеек, задетых прямоугольником
+    template<typename Visit>
+    void ForEachInCells(float x0, float y0, float x1, float y1, Visit visit) const {
+        int cx0 = CellCoord(x0), cx1 = CellCoord(x1);
+        int cy0 = CellCoord(y0), cy1 = CellCoord(y1);
+        // Большой прямоугольник дешевле проверить по непустым ячейкам
+        if (static_cast<long long>(cx1 - cx0 + 1) * (cy1 - cy0 + 1) > static_cast<long long>(cells.size())) {
+            for (const auto& cell : cells) {
+                for (int id : cell.second) visit(id);
+            }
+            return;
+        }
+        for (int cx = cx0; cx <= cx1; ++cx) {
+            for (int cy = cy0; cy <= cy1; ++cy) {
+                auto it = cells.find(CellKey(cx, cy));
+                if (it == cells.end()) continue;
+                for (int id : it->second) visit(id);
             }
-            cout << endl;
         }
     }
 
-    pair<vector<int>, int> SolveTSP() {
-        vector<int> path;
-        int min_path = INF;
+public:
+    explicit SpatialGrid(float cellSize) : cellSize(cellSize) {}
 
-        if (vertList.size() < 2) return { path, 0 };
+    void Insert(int id, float x, float y) {
+        if (id >= static_cast<int>(positions.size())) {
+            positions.resize(id + 1);
+            present.resize(id + 1, false);
+        }
+        if (present[id]) Remove(id);
+        positions[id] = make_pair(x, y);
+        present[id] = true;
+        cells[CellKey(CellCoord(x), CellCoord(y))].push_back(id);
+    }
 
-        vector<bool> visited(vertList.size(), false);
-        vector<int> current_path;
-        current_path.push_back(0);
-        visited[0] = true;
+    void Remove(int id) {
+        if (id < 0 || id >= static_cast<int>(present.size()) || !present[id]) return;
+        auto it = cells.find(CellKey(CellCoord(positions[id].first), CellCoord(positions[id].second)));
+        vector<int>& cell = it->second;
+        *find(cell.begin(), cell.end(), id) = cell.back();
+        cell.pop_back();
+        if (cell.empty()) cells.erase(it);
+        present[id] = false;
+    }
 
-        TSPRec(0, 1, 0, visited, current_path, path, min_path);
+    void Clear() {
+        cells.clear();
+        positions.clear();
+        present.clear();
+    }
 
-        vector<int> result_path;
-        for (int idx : path) {
-            result_path.push_back(vertList[idx]);
-        }
-        result_path.push_back(vertList[0]);
+    // Вершина с наименьшим номером не дальше radius от точки, или -1
+    int FindAt(float x, float y, float radius) const {
+        int found = -1;
+        ForEachInCells(x - radius, y - radius, x + radius, y + radius, [&](int id) {
+            float dx = positions[id].first - x;
+            float dy = positions[id].second - y;
+            if (dx * dx + dy * dy <= radius * radius && (found == -1 || id < found)) found = id;
+        });
+        return found;
+    }
 
-        return { result_path, min_path };
+    // Вершины внутри прямоугольника (границы включаются), по возрастанию номеров
+    vector<int> QueryRect(float x0, float y0, float x1, float y1) const {
+        vector<int> found;
+        ForEachInCells(x0, y0, x1, y1, [&](int id) {
+            const pair<float, float>& p = positions[id];
+            if (p.first >= x0 && p.first <= x1 && p.second >= y0 && p.second <= y1) found.push_back(id);
+        });
+        sort(found.begin(), found.end());
+        return found;
     }
+};
 
+// Пакетная отрисовка через вершинные массивы OpenGL 1.1: примитивы кадра копятся в
+// массивах координат и цветов и уходят одним glDrawArrays на тип примитива. Круги
+// собираются из заранее посчитанной единичной окружности, без cos/sin в кадре.
+class RenderBatch {
 private:
-    void TSPRec(int current_pos, int count, int current_cost,
-        vector<bool>& visited, vector<int>& current_path,
-        vector<int>& final_path, int& final_cost) {
-        if (count == vertList.size()) {
-            int return_cost = adjMatrix[current_path.back()][current_path[0]];
-            if (return_cost != INF) {
-                int total_cost = current_cost + return_cost;
-                if (total_cost < final_cost) {
-                    final_cost = total_cost;
-                    final_path = current_path;
-                }
-            }
-            return;
+    static const int circleSegments = 36;
+    vector<float> unitCircle;  // cos, sin для точек 0 .. circleSegments (последняя = первая)
+    vector<float> triangles;
+    vector<float> triangleColors;
+    vector<float> lines;
+    vector<float> lineColors;
+    float color[3];
+
+    void PushVertex(vector<float>& vertices, vector<float>& colors, float x, float y) {
+        vertices.push_back(x);
+        vertices.push_back(y);
+        colors.insert(colors.end(), color, color + 3);
+    }
+
+    static void DrawArrays(GLenum mode, const vector<float>& vertices, const vector<float>& colors) {
+        if (vertices.empty()) return;
+        glVertexPointer(2, GL_FLOAT, 0, vertices.data());
+        glColorPointer(3, GL_FLOAT, 0, colors.data());
+        glDrawArrays(mode, 0, static_cast<GLsizei>(vertices.size() / 2));
+    }
+
+public:
+    RenderBatch() : unitCircle(2 * (circleSegments + 1)) {
+        for (int i = 0; i <= circleSegments; ++i) {
+            float angle = 2.0f * PI * i / circleSegments;
+            unitCircle[2 * i] = cos(angle);
+            unitCircle[2 * i + 1] = sin(angle);
         }
+        SetColor(0.0f, 0.0f, 0.0f);
+    }
 
-        for (size_t i = 0; i < vertList.size(); ++i) {
-            if (!visited[i] && adjMatrix[current_pos][i] != INF) {
-                int new_cost = current_cost + adjMatrix[current_pos][i];
-                if (new_cost < final_cost) {
-                    visited[i] = true;
-                    current_path.push_back(i);
+    void SetColor(float r, float g, float b) {
+        color[0] = r;
+        color[1] = g;
+        color[2] = b;
+    }
 
-                    TSPRec(i, count + 1, new_cost, visited, current_path, final_path, final_cost);
+    void AddLine(float x1, float y1, float x2, float y2) {
+        PushVertex(lines, lineColors, x1, y1);
+        PushVertex(lines, lineColors, x2, y2);
+    }
 
-                    visited[i] = false;
-                    current_path.pop_back();
-                }
-            }
+    void AddTriangle(float x1, float y1, float x2, float y2, float x3, float y3) {
+        PushVertex(triangles, triangleColors, x1, y1);
+        PushVertex(triangles, triangleColors, x2, y2);
+        PushVertex(triangles, triangleColors, x3, y3);
+    }
+
+    void AddDisc(float x, float y, float radius) {
+        for (int i = 0; i < circleSegments; ++i) {
+            AddTriangle(x, y,
+                x + radius * unitCircle[2 * i], y + radius * unitCircle[2 * i + 1],
+                x + radius * unitCircle[2 * i + 2], y + radius * unitCircle[2 * i + 3]);
         }
     }
 
-public:
-    const vector<int>& getVertices() const { return vertList; }
-    const int(&getAdjMatrix() const)[maxSize][maxSize]{ return adjMatrix; }
+    void AddCircle(float x, float y, float radius) {
+        for (int i = 0; i < circleSegments; ++i) {
+            AddLine(x + radius * unitCircle[2 * i], y + radius * unitCircle[2 * i + 1],
+                x + radius * unitCircle[2 * i + 2], y + radius * unitCircle[2 * i + 3]);
+        }
+    }
+
+    // Треугольники, затем линии поверх; накопленное сбрасывается
+    void Flush() {
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        DrawArrays(GL_TRIANGLES, triangles, triangleColors);
+        DrawArrays(GL_LINES, lines, lineColors);
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+        triangles.clear();
+        triangleColors.clear();
+        lines.clear();
+        lineColors.clear();
+    }
 };
 
 class GraphVisualizer {
@@ -219,19 +3233,94 @@ private:
     bool weightInputMode;
     int inputWeight;
     vector<pair<float, float>> vertexPositions;
+    SpatialGrid nodeGrid;       // по vertexPositions, пересобирается в arrangeVertices
+    RenderBatch batch;
     bool showTSP;
     vector<int> tspPath;
     int tspCost;
+    int heuristicCost;
+    SearchStats tspStats;       // последнего синхронного решения
+    TSPMethod tspMethod;
+    bool asyncMode;
+    bool tspSearching;
+    AsyncTSPSolver asyncSolver;
+    SolutionCache solutionCache;
 
     int findNodeAt(int x, int y) const {
-        for (size_t i = 0; i < vertexPositions.size(); ++i) {
-            float dx = vertexPositions[i].first - static_cast<float>(x);
-            float dy = vertexPositions[i].second - static_cast<float>(y);
-            if (dx * dx + dy * dy <= NODE_RADIUS * NODE_RADIUS) {
-                return static_cast<int>(i);
+        return nodeGrid.FindAt(static_cast<float>(x), static_cast<float>(y), NODE_RADIUS);
+    }
+
+    // Направление дуги i -> j (единичный вектор); false, если вершины перекрываются
+    bool arcDirection(size_t i, size_t j, float& dx, float& dy) const {
+        float x1 = vertexPositions[i].first;
+        float y1 = vertexPositions[i].second;
+        float x2 = vertexPositions[j].first;
+        float y2 = vertexPositions[j].second;
+        float length = sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+        if (length <= 2.0f * NODE_RADIUS) return false;
+        dx = (x2 - x1) / length;
+        dy = (y2 - y1) / length;
+        return true;
+    }
+
+    // Ребро - в пакет. Дуга ориентированного графа смещена вправо от направления, чтобы
+    // встречные дуги не совпадали, и кончается стрелкой у границы вершины j
+    void addArcGeometry(size_t i, size_t j) {
+        float x1 = vertexPositions[i].first;
+        float y1 = vertexPositions[i].second;
+        float x2 = vertexPositions[j].first;
+        float y2 = vertexPositions[j].second;
+        batch.SetColor(0.5f, 0.5f, 0.5f);
+        if (!graph.IsDirected()) {
+            batch.AddLine(x1, y1, x2, y2);
+            return;
+        }
+
+        float dx, dy;
+        if (!arcDirection(i, j, dx, dy)) return;
+        float ox = -dy * 4.0f;
+        float oy = dx * 4.0f;
+        float tipX = x2 - dx * NODE_RADIUS + ox;
+        float tipY = y2 - dy * NODE_RADIUS + oy;
+        batch.AddLine(x1 + dx * NODE_RADIUS + ox, y1 + dy * NODE_RADIUS + oy, tipX, tipY);
+        batch.AddTriangle(tipX, tipY,
+            tipX - dx * 10.0f - dy * 4.0f, tipY - dy * 10.0f + dx * 4.0f,
+            tipX - dx * 10.0f + dy * 4.0f, tipY - dy * 10.0f - dx * 4.0f);
+    }
+
+    // Вес у середины ребра; у дуги - со стороны её смещения
+    void drawArcLabel(size_t i, size_t j, int weight) {
+        float x = (vertexPositions[i].first + vertexPositions[j].first) / 2.0f;
+        float y = (vertexPositions[i].second + vertexPositions[j].second) / 2.0f;
+        if (graph.IsDirected()) {
+            float dx, dy;
+            if (!arcDirection(i, j, dx, dy)) return;
+            x -= dy * 12.0f;
+            y += dx * 12.0f;
+        }
+        glColor3f(0.0f, 0.0f, 0.0f);
+        drawText(x, y, to_string(weight));
+    }
+
+    // Рёбра графа: fn(i, j, вес); у неориентированного каждое ребро один раз
+    template <typename Fn>
+    void forEachEdge(Fn fn) const {
+        const auto& adjMatrix = graph.getAdjMatrix();
+        size_t count = graph.getVertices().size();
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t j = graph.IsDirected() ? 0 : i + 1; j < count; ++j) {
+                if (i != j && adjMatrix[i][j] != INF) fn(i, j, adjMatrix[i][j]);
             }
         }
-        return -1;
+    }
+
+    // Все рёбра: сначала геометрия одним пакетом, затем подписи весов
+    void drawEdges() {
+        forEachEdge([this](size_t i, size_t j, int) { addArcGeometry(i, j); });
+        glLineWidth(1.0f);
+        batch.Flush();
+        if (!showWeights) return;
+        forEachEdge([this](size_t i, size_t j, int weight) { drawArcLabel(i, j, weight); });
     }
 
     void arrangeVertices() {
@@ -247,13 +3336,22 @@ private:
             float y = centerY + radius * sin(angle);
             vertexPositions.emplace_back(x, y);
         }
+
+        nodeGrid.Clear();
+        for (size_t i = 0; i < vertexPositions.size(); ++i) {
+            nodeGrid.Insert(static_cast<int>(i), vertexPositions[i].first, vertexPositions[i].second);
+        }
     }
 
 public:
     GraphVisualizer() : selectedNode(-1), showWeights(true),
         edgeCreationMode(false), edgeStartNode(-1),
-        weightInputMode(false), inputWeight(1),
-        showTSP(false), tspCost(0) {
+        weightInputMode(false), inputWeight(1), nodeGrid(2.0f * NODE_RADIUS),
+        showTSP(false), tspCost(0), heuristicCost(INF), tspMethod(TSPMethod::BranchAndBound),
+        asyncMode(false), tspSearching(false) {
+        graph.SetCache(&solutionCache);
+        // Матрица примера несимметрична, поэтому граф ориентированный
+        graph.SetDirected(true);
         // Инициализация тестового графа
         for (int i = 1; i <= 7; i++) {
             graph.InsertVertex(i);
@@ -285,65 +3383,45 @@ public:
 
         // Отрисовка рёбер
         const auto& vertices = graph.getVertices();
-        const auto& adjMatrix = graph.getAdjMatrix();
-
-        for (size_t i = 0; i < vertices.size(); ++i) {
-            for (size_t j = i + 1; j < vertices.size(); ++j) {
-                if (adjMatrix[i][j] != INF) {
-                    float x1 = vertexPositions[i].first;
-                    float y1 = vertexPositions[i].second;
-                    float x2 = vertexPositions[j].first;
-                    float y2 = vertexPositions[j].second;
-
-                    glColor3f(0.5f, 0.5f, 0.5f);
-                    glLineWidth(1.0f);
-                    glBegin(GL_LINES);
-                    glVertex2f(x1, y1);
-                    glVertex2f(x2, y2);
-                    glEnd();
-
-                    if (showWeights) {
-                        float midX = (x1 + x2) / 2.0f;
-                        float midY = (y1 + y2) / 2.0f;
-                        glColor3f(0.0f, 0.0f, 0.0f);
-                        drawText(midX, midY, to_string(adjMatrix[i][j]));
-                    }
-                }
-            }
-        }
+        drawEdges();
 
-        // Отрисовка пути коммивояжера
+        // Отрисовка пути коммивояжера: замкнутая ломаная по найденным позициям
         if (showTSP && !tspPath.empty()) {
-            glColor3f(0.0f, 1.0f, 0.0f);
-            glLineWidth(3.0f);
-            glBegin(GL_LINE_LOOP);
+            batch.SetColor(0.0f, 1.0f, 0.0f);
+            int first = -1;
+            int previous = -1;
             for (int v : tspPath) {
                 int pos = graph.GetVertPos(v);
-                if (pos != -1) {
-                    glVertex2f(vertexPositions[pos].first, vertexPositions[pos].second);
+                if (pos == -1) continue;
+                if (previous != -1) {
+                    batch.AddLine(vertexPositions[previous].first, vertexPositions[previous].second,
+                        vertexPositions[pos].first, vertexPositions[pos].second);
+                }
+                else {
+                    first = pos;
                 }
+                previous = pos;
             }
-            glEnd();
+            if (first != -1 && previous != first) {
+                batch.AddLine(vertexPositions[previous].first, vertexPositions[previous].second,
+                    vertexPositions[first].first, vertexPositions[first].second);
+            }
+            glLineWidth(3.0f);
+            batch.Flush();
             glLineWidth(1.0f);
         }
 
         // Отрисовка вершин
         for (size_t i = 0; i < vertices.size(); ++i) {
-            float x = vertexPositions[i].first;
-            float y = vertexPositions[i].second;
-
-            glColor3f(i == static_cast<size_t>(selectedNode) ? 1.0f : 0.0f, 0.0f, 0.0f);
-            glBegin(GL_TRIANGLE_FAN);
-            glVertex2f(x, y);
-            for (int j = 0; j <= 360; j += 10) {
-                float a = static_cast<float>(j) * PI / 180.0f;
-                glVertex2f(x + NODE_RADIUS * cos(a), y + NODE_RADIUS * sin(a));
-            }
-            glEnd();
+            batch.SetColor(i == static_cast<size_t>(selectedNode) ? 1.0f : 0.0f, 0.0f, 0.0f);
+            batch.AddDisc(vertexPositions[i].first, vertexPositions[i].second, NODE_RADIUS);
+        }
+        batch.Flush();
 
+        for (size_t i = 0; i < vertices.size(); ++i) {
             glColor3f(1.0f, 1.0f, 1.0f);
             string text = to_string(vertices[i]);
-            drawText(x - (text.length() > 1 ? 7.0f : 5.0f), y + 5.0f, text);
+            drawText(vertexPositions[i].first - (text.length() > 1 ? 7.0f : 5.0f), vertexPositions[i].second + 5.0f, text);
         }
 
         drawInfoText();
@@ -361,14 +3439,24 @@ public:
         drawText(10.0f, 120.0f, "W - change the edge weight");
         drawText(10.0f, 140.0f, "T - traveling salesman problem");
         drawText(10.0f, 160.0f, "P - print matrix");
-        drawText(10.0f, 180.0f, "ESC - cancellation");
+        drawText(10.0f, 180.0f, string("M - solver: ") + TSPMethodName(tspMethod));
+        drawText(10.0f, 200.0f, string("A - background solving: ") + (asyncMode ? "on" : "off"));
+        drawText(10.0f, 220.0f, "ESC - cancellation");
+        drawText(10.0f, 240.0f, string("O - one-way edges: ") + (graph.IsDirected() ? "on" : "off"));
 
         if (showTSP) {
             stringstream ss;
-            ss << "Оптимальный маршрут: ";
+            ss << (tspSearching ? "Лучший найденный маршрут (поиск...): " : "Оптимальный маршрут: ");
             for (int v : tspPath) ss << v << " ";
             ss << " (стоимость: " << tspCost << ")";
-            drawText(10.0f, 220.0f, ss.str());
+            drawText(10.0f, 260.0f, ss.str());
+
+            if (tspMethod != TSPMethod::Heuristic && heuristicCost != INF && tspCost != INF && tspCost > 0) {
+                stringstream hs;
+                hs << "Эвристика: " << heuristicCost << " (+"
+                    << 100.0 * (heuristicCost - tspCost) / tspCost << "%)";
+                drawText(10.0f, 280.0f, hs.str());
+            }
         }
         string modeText;
         if (weightInputMode) {
@@ -386,7 +3474,63 @@ public:
                 modeText += " (выбрана: " + to_string(graph.getVertices()[static_cast<size_t>(selectedNode)]) + ")";
             }
         }
-        drawText(10.0f, 250.0f, modeText);
+        drawText(10.0f, 300.0f, modeText);
+
+        stringstream cacheText;
+        cacheText << "Кэш решений: попаданий " << solutionCache.GetMemoryHits()
+            << " (с диска " << solutionCache.GetDiskHits() << "), промахов " << solutionCache.GetMisses();
+        drawText(10.0f, 320.0f, cacheText.str());
+
+        if (showTSP && tspStats.nodesExpanded > 0) {
+            stringstream searchText;
+            searchText << "Поиск: раскрыто " << tspStats.nodesExpanded << ", отсечено " << tspStats.nodesPruned
+                << ", рекордов " << tspStats.incumbents.size();
+            if (!tspStats.incumbents.empty()) {
+                searchText << " (последний " << tspStats.incumbents.back().milliseconds << " мс)";
+            }
+            drawText(10.0f, 340.0f, searchText.str());
+
+            // Разбивка по глубине: раскрыто/отсечено, первые уровни
+            if (!tspStats.expandedByDepth.empty()) {
+                stringstream depthText;
+                depthText << "По глубине:";
+                size_t shown = min<size_t>(tspStats.expandedByDepth.size(), 16);
+                for (size_t d = 0; d < shown; ++d) {
+                    long long pruned = d < tspStats.prunedByDepth.size() ? tspStats.prunedByDepth[d] : 0;
+                    if (tspStats.expandedByDepth[d] == 0 && pruned == 0) continue;
+                    depthText << " " << d << ":" << tspStats.expandedByDepth[d] << "/" << pruned;
+                }
+                if (shown < tspStats.expandedByDepth.size()) depthText << " ...";
+                drawText(10.0f, 360.0f, depthText.str());
+            }
+        }
+    }
+
+    void setCacheDirectory(const string& path) { solutionCache.SetDirectory(path); }
+
+    // Забирает последний опубликованный фоновым поиском маршрут (вызывается по таймеру)
+    void update() {
+        if (!tspSearching) return;
+
+        bool finished = !asyncSolver.IsRunning();
+        const TSPSnapshot* snapshot = asyncSolver.Latest();
+        if (snapshot) {
+            tspPath = snapshot->path;
+            tspCost = snapshot->cost;
+        }
+        if (finished) {
+            tspSearching = false;
+            cout << (snapshot && snapshot->optimal ? "Оптимальный маршрут: " : "Лучший найденный маршрут: ");
+            for (int v : tspPath) cout << v << " ";
+            cout << "\nСтоимость: " << tspCost << endl;
+        }
+        glutPostRedisplay();
+    }
+
+    // Любое изменение графа делает фоновый поиск бессмысленным
+    void cancelBackgroundSolve() {
+        asyncSolver.Cancel();
+        tspSearching = false;
     }
 
     void handleMouseClick(int button, int state, int x, int y) {
@@ -409,6 +3553,7 @@ public:
                     }
                 }
                 else if (edgeStartNode == -1) {
+                    cancelBackgroundSolve();
                     int newId = graph.AddVertexAtPosition(static_cast<float>(x), static_cast<float>(y));
                     if (newId != -1) {
                         vertexPositions.emplace_back(static_cast<float>(x), static_cast<float>(y));
@@ -418,6 +3563,7 @@ public:
             }
             else {
                 if (clickedNode == -1) {
+                    cancelBackgroundSolve();
                     int newId = graph.AddVertexAtPosition(static_cast<float>(x), static_cast<float>(y));
                     if (newId != -1) {
                         vertexPositions.emplace_back(static_cast<float>(x), static_cast<float>(y));
@@ -448,6 +3594,7 @@ public:
             }
             else if (key == 13) { // Enter
                 if (edgeStartNode != -1 && selectedNode != -1 && edgeStartNode != selectedNode) {
+                    cancelBackgroundSolve();
                     graph.InsertEdge(
                         graph.getVertices()[static_cast<size_t>(edgeStartNode)],
                         graph.getVertices()[static_cast<size_t>(selectedNode)],
@@ -470,9 +3617,10 @@ public:
             break;
         case 'd': case 'D':
             if (selectedNode != -1) {
+                cancelBackgroundSolve();
                 graph.RemoveVertex(graph.getVertices()[static_cast<size_t>(selectedNode)]);
-                vertexPositions.erase(vertexPositions.begin() + selectedNode);
                 selectedNode = -1;
+                // Позиции заново раскладываются по кругу под новый порядок вершин
                 arrangeVertices();
             }
             break;
@@ -483,19 +3631,49 @@ public:
             }
             break;
         case 't': case 'T': {
-            auto result = graph.SolveTSP();
+            if (asyncMode) {
+                tspPath.clear();
+                tspCost = INF;
+                heuristicCost = INF;
+                tspStats = SearchStats();
+                showTSP = true;
+                tspSearching = true;
+                asyncSolver.Start(graph.GetCostMatrix(), graph.getVertices(), tspMethod);
+                break;
+            }
+            cancelBackgroundSolve();
+            auto result = graph.SolveTSP(tspMethod, &tspStats);
             tspPath = result.first;
             tspCost = result.second;
+            heuristicCost = tspMethod == TSPMethod::Heuristic
+                ? tspCost
+                : graph.SolveTSP(TSPMethod::Heuristic).second;
             showTSP = true;
             cout << "Оптимальный маршрут: ";
             for (int v : tspPath) cout << v << " ";
             cout << "\nСтоимость: " << tspCost << endl;
+            cout << "Эвристика: " << heuristicCost << endl;
         }
                 break;
         case 'p': case 'P':
             graph.Print();
             break;
+        case 'm': case 'M':
+            tspMethod = NextTSPMethod(tspMethod);
+            break;
+        case 'a': case 'A':
+            asyncMode = !asyncMode;
+            break;
+        case 'o': case 'O':
+            graph.SetDirected(!graph.IsDirected());
+            break;
         case 27: // ESC
+            if (tspSearching) {
+                // Останавливаем поиск, лучший найденный маршрут остаётся на экране
+                asyncSolver.Cancel();
+                update();
+                break;
+            }
             edgeCreationMode = false;
             weightInputMode = false;
             edgeStartNode = -1;
@@ -507,6 +3685,399 @@ public:
     }
 };
 
+// Решение с ограничением по времени: сторожевой поток поднимает флаг отмены, решатель
+// сворачивается и возвращает лучший найденный обход. limitMs <= 0 - без ограничения.
+template <typename Solve>
+pair<vector<int>, int> RunWithTimeLimit(int limitMs, bool& timedOut, Solve solve) {
+    timedOut = false;
+    if (limitMs <= 0) return solve(nullptr);
+
+    atomic<bool> stop(false);
+    mutex lock;
+    condition_variable finished;
+    bool done = false;
+
+    thread watchdog([&]() {
+        unique_lock<mutex> guard(lock);
+        if (!finished.wait_for(guard, chrono::milliseconds(limitMs), [&]() { return done; })) {
+            stop.store(true);
+        }
+    });
+
+    auto result = solve(&stop);
+    {
+        lock_guard<mutex> guard(lock);
+        done = true;
+    }
+    finished.notify_one();
+    watchdog.join();
+
+    timedOut = stop.load();
+    return result;
+}
+
+pair<vector<int>, int> SolveWithTimeLimit(const vector<int>& cost, int n, TSPMethod method,
+    SearchStats& stats, int limitMs, bool& timedOut) {
+    return RunWithTimeLimit(limitMs, timedOut, [&](const atomic<bool>* stop) {
+        return SolveTSPMatrix(cost, n, method, &stats, stop);
+    });
+}
+
+// Пакетный режим без окна:
+//   kommivoyajor --batch <каталог или файл .tsp/.atsp> [--solver имя] [--format csv|json] [--out файл]
+//     [--memory-mb N] [--time-limit мс]
+// Решение дольше time-limit (по умолчанию минута, 0 - без ограничения) прерывается
+// со статусом timeout; в выводе остаётся лучший найденный к этому моменту обход.
+struct BatchResult {
+    string instance;
+    int n;
+    string solver;
+    int cost;
+    double milliseconds;
+    vector<int> tour;
+    string status;
+    SearchStats stats;
+};
+
+string JsonEscape(const string& text) {
+    string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+void WriteSearchStatsJson(ostream& out, const SearchStats& stats) {
+    out << "{\"expanded\": " << stats.nodesExpanded << ", \"pruned\": " << stats.nodesPruned
+        << ", \"expanded_by_depth\": [";
+    for (size_t d = 0; d < stats.expandedByDepth.size(); ++d) out << (d ? ", " : "") << stats.expandedByDepth[d];
+    out << "], \"pruned_by_depth\": [";
+    for (size_t d = 0; d < stats.prunedByDepth.size(); ++d) out << (d ? ", " : "") << stats.prunedByDepth[d];
+    out << "], \"incumbents\": [";
+    for (size_t k = 0; k < stats.incumbents.size(); ++k) {
+        out << (k ? ", " : "") << "{\"cost\": " << stats.incumbents[k].cost
+            << ", \"time_ms\": " << stats.incumbents[k].milliseconds << "}";
+    }
+    out << "]}";
+}
+
+void WriteBatchResults(ostream& out, const vector<BatchResult>& results, bool json) {
+    if (!json) {
+        out << "instance,n,solver,status,cost,time_ms,tour\n";
+        for (const BatchResult& r : results) {
+            out << r.instance << "," << r.n << "," << r.solver << "," << r.status << ",";
+            if (r.cost != INF) out << r.cost;
+            out << "," << r.milliseconds << ",";
+            for (size_t i = 0; i < r.tour.size(); ++i) out << (i ? " " : "") << r.tour[i];
+            out << "\n";
+        }
+        return;
+    }
+
+    out << "[\n";
+    for (size_t k = 0; k < results.size(); ++k) {
+        const BatchResult& r = results[k];
+        out << "  {\"instance\": \"" << JsonEscape(r.instance) << "\", \"n\": " << r.n
+            << ", \"solver\": \"" << r.solver << "\", \"status\": \"" << JsonEscape(r.status) << "\", \"cost\": ";
+        if (r.cost != INF) out << r.cost;
+        else out << "null";
+        out << ", \"time_ms\": " << r.milliseconds << ", \"tour\": [";
+        for (size_t i = 0; i < r.tour.size(); ++i) out << (i ? ", " : "") << r.tour[i];
+        out << "], \"search\": ";
+        WriteSearchStatsJson(out, r.stats);
+        out << "}" << (k + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+int RunBatch(int argc, char** argv) {
+    string input;
+    string outputPath;
+    TSPMethod method = TSPMethod::Heuristic;
+    bool json = false;
+    int timeLimitMs = 60000;
+
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--solver" && i + 1 < argc) {
+            if (!ParseTSPMethod(argv[++i], method)) {
+                cerr << "Неизвестный решатель: " << argv[i] << endl;
+                return 2;
+            }
+        }
+        else if (arg == "--format" && i + 1 < argc) json = string(argv[++i]) == "json";
+        else if (arg == "--out" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "--memory-mb" && i + 1 < argc) heldKarpMemoryBudget = strtoull(argv[++i], nullptr, 10) << 20;
+        else if (arg == "--time-limit" && i + 1 < argc) timeLimitMs = atoi(argv[++i]);
+        else input = arg;
+    }
+    if (input.empty()) {
+        cerr << "Использование: kommivoyajor --batch <каталог|файл> [--solver "
+            << "exhaustive|held-karp|bnb|parallel-bnb|ap-bnb|heuristic] [--format csv|json] [--out файл]"
+            << " [--memory-mb N] [--time-limit мс]" << endl;
+        return 2;
+    }
+
+    vector<string> files;
+    if (filesystem::is_directory(input)) {
+        for (const auto& entry : filesystem::directory_iterator(input)) {
+            string extension = entry.path().extension().string();
+            if (entry.is_regular_file() && (extension == ".tsp" || extension == ".atsp")) {
+                files.push_back(entry.path().string());
+            }
+        }
+        sort(files.begin(), files.end());
+    }
+    else {
+        files.push_back(input);
+    }
+
+    vector<BatchResult> results;
+    for (const string& file : files) {
+        BatchResult result;
+        result.instance = filesystem::path(file).filename().string();
+        result.solver = TSPMethodKey(method);
+        result.n = 0;
+        result.cost = INF;
+        result.milliseconds = 0.0;
+
+        TSPInstance instance;
+        string error;
+        if (!LoadTSPLIB(file, instance, error)) {
+            result.status = error;
+            results.push_back(result);
+            continue;
+        }
+        result.n = instance.dimension;
+
+        if (method == TSPMethod::HeldKarp && instance.dimension > CompactHeldKarpSolver<int>::maxCities) {
+            result.status = "too large for held-karp";
+            results.push_back(result);
+            continue;
+        }
+
+        auto start = chrono::steady_clock::now();
+        pair<vector<int>, int> solution;
+        bool timedOut = false;
+        if (method == TSPMethod::Heuristic && instance.edgeWeightType == "EUC_2D") {
+            // Матрица n x n для эвристики не нужна: расстояния считаются по координатам
+            solution = RunWithTimeLimit(timeLimitMs, timedOut, [&](const atomic<bool>* stop) {
+                return SolveEuclideanHeuristic(instance.x, instance.y, stop, &result.stats);
+            });
+        }
+        else {
+            vector<int> cost = instance.BuildCostMatrix();
+            start = chrono::steady_clock::now();
+            solution = SolveWithTimeLimit(cost, instance.dimension, method, result.stats, timeLimitMs, timedOut);
+        }
+        result.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        result.cost = solution.second;
+        result.status = timedOut ? "timeout"
+            : result.stats.budgetExceeded ? "memory budget exceeded"
+            : solution.first.empty() ? "no tour" : "ok";
+        // Города в выводе нумеруются с 1, как в TSPLIB
+        for (int city : solution.first) result.tour.push_back(city + 1);
+        results.push_back(result);
+    }
+
+    if (outputPath.empty()) {
+        WriteBatchResults(cout, results, json);
+    }
+    else {
+        ofstream out(outputPath);
+        WriteBatchResults(out, results, json);
+    }
+    return 0;
+}
+
+// Генератор тестовых задач. Используются только сырые значения mt19937 - стандартные
+// распределения реализованы в разных библиотеках по-разному, а задачи должны совпадать
+class InstanceGenerator {
+private:
+    mt19937 rng;
+
+    double Uniform() { return rng() / 4294967296.0; }
+
+    double Normal() {
+        double u1 = 1.0 - Uniform();
+        double u2 = Uniform();
+        return sqrt(-2.0 * log(u1)) * cos(2.0 * PI * u2);
+    }
+
+    static vector<int> FromPoints(const vector<double>& x, const vector<double>& y) {
+        int n = static_cast<int>(x.size());
+        vector<int> cost(static_cast<size_t>(n) * n);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                cost[static_cast<size_t>(i) * n + j] =
+                    static_cast<int>(sqrt((x[i] - x[j]) * (x[i] - x[j]) + (y[i] - y[j]) * (y[i] - y[j])) + 0.5);
+            }
+        }
+        return cost;
+    }
+
+public:
+    explicit InstanceGenerator(unsigned seed) : rng(seed) {}
+
+    // Равномерные точки в квадрате 1000 x 1000
+    vector<int> Euclidean(int n) {
+        vector<double> x(n), y(n);
+        for (int i = 0; i < n; ++i) {
+            x[i] = Uniform() * 1000.0;
+            y[i] = Uniform() * 1000.0;
+        }
+        return FromPoints(x, y);
+    }
+
+    // Точки вокруг n/5 центров с нормальным разбросом
+    vector<int> Clustered(int n) {
+        int clusters = max(2, n / 5);
+        vector<double> cx(clusters), cy(clusters);
+        for (int c = 0; c < clusters; ++c) {
+            cx[c] = Uniform() * 1000.0;
+            cy[c] = Uniform() * 1000.0;
+        }
+        vector<double> x(n), y(n);
+        for (int i = 0; i < n; ++i) {
+            int c = static_cast<int>(rng() % clusters);
+            x[i] = cx[c] + Normal() * 30.0;
+            y[i] = cy[c] + Normal() * 30.0;
+        }
+        return FromPoints(x, y);
+    }
+
+    // Независимые веса 1..1000 в каждую сторону
+    vector<int> Asymmetric(int n) {
+        vector<int> cost(static_cast<size_t>(n) * n, 0);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                if (i != j) cost[static_cast<size_t>(i) * n + j] = 1 + static_cast<int>(rng() % 1000);
+            }
+        }
+        return cost;
+    }
+};
+
+struct BenchmarkRow {
+    string family;
+    int n;
+    unsigned seed;
+    string solver;
+    string status;
+    int cost;
+    int optimum;
+    SearchStats stats;
+    double milliseconds;
+};
+
+void WriteBenchmarkRows(ostream& out, const vector<BenchmarkRow>& rows, bool json) {
+    auto gap = [](const BenchmarkRow& r) {
+        return 100.0 * (static_cast<double>(r.cost) - r.optimum) / max(r.optimum, 1);
+    };
+
+    if (!json) {
+        out << "family,n,seed,solver,status,cost,gap_pct,nodes,pruned,incumbents,time_ms,peak_mem_kb\n";
+        for (const BenchmarkRow& r : rows) {
+            out << r.family << "," << r.n << "," << r.seed << "," << r.solver << "," << r.status << ",";
+            if (r.cost != INF) out << r.cost;
+            out << ",";
+            if (r.cost != INF && r.optimum != INF) out << gap(r);
+            out << "," << r.stats.nodesExpanded << "," << r.stats.nodesPruned << "," << r.stats.incumbents.size()
+                << "," << r.milliseconds << "," << r.stats.peakMemoryBytes / 1024 << "\n";
+        }
+        return;
+    }
+
+    out << "[\n";
+    for (size_t k = 0; k < rows.size(); ++k) {
+        const BenchmarkRow& r = rows[k];
+        out << "  {\"family\": \"" << r.family << "\", \"n\": " << r.n << ", \"seed\": " << r.seed
+            << ", \"solver\": \"" << r.solver << "\", \"status\": \"" << r.status << "\", \"cost\": ";
+        if (r.cost != INF) out << r.cost;
+        else out << "null";
+        out << ", \"gap_pct\": ";
+        if (r.cost != INF && r.optimum != INF) out << gap(r);
+        else out << "null";
+        out << ", \"nodes\": " << r.stats.nodesExpanded << ", \"time_ms\": " << r.milliseconds
+            << ", \"peak_mem_kb\": " << r.stats.peakMemoryBytes / 1024 << ", \"search\": ";
+        WriteSearchStatsJson(out, r.stats);
+        out << "}" << (k + 1 < rows.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+// Замер всех решателей на сгенерированных задачах:
+//   kommivoyajor --bench [--seed N] [--max-n N] [--time-limit мс] [--memory-mb N] [--format csv|json] [--out файл]
+// Размеры от 8 до max-n с шагом 2; полный перебор запускается до 12 городов,
+// Хелд-Карп - до 22. Прогон дольше time-limit (0 - без ограничения) прерывается со статусом timeout,
+// не поместившийся в memory-mb Хелд-Карп получает статус memory.
+// peak_mem_kb - наибольший объём, который решатель сам насчитал за прогон
+// (SearchStats::peakMemoryBytes): таблицы Хелда-Карпа, матрицы открытых узлов ветвей
+// и границ во всех потоках, списки кандидатов эвристики. Это не RSS процесса.
+int RunBenchmark(int argc, char** argv) {
+    unsigned seed = 1;
+    int maxN = 20;
+    int timeLimitMs = 10000;
+    bool json = false;
+    string outputPath;
+
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) seed = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--max-n" && i + 1 < argc) maxN = atoi(argv[++i]);
+        else if (arg == "--time-limit" && i + 1 < argc) timeLimitMs = atoi(argv[++i]);
+        else if (arg == "--memory-mb" && i + 1 < argc) heldKarpMemoryBudget = strtoull(argv[++i], nullptr, 10) << 20;
+        else if (arg == "--format" && i + 1 < argc) json = string(argv[++i]) == "json";
+        else if (arg == "--out" && i + 1 < argc) outputPath = argv[++i];
+    }
+
+    const char* families[] = { "euclidean", "clustered", "asymmetric" };
+    const TSPMethod methods[] = { TSPMethod::Exhaustive, TSPMethod::HeldKarp, TSPMethod::BranchAndBound,
+        TSPMethod::ParallelBranchAndBound, TSPMethod::AssignmentBranchAndBound, TSPMethod::Heuristic };
+
+    vector<BenchmarkRow> rows;
+    for (int n = 8; n <= maxN; n += 2) {
+        for (int family = 0; family < 3; ++family) {
+            unsigned instanceSeed = seed * 1000003u + static_cast<unsigned>(n) * 31u + static_cast<unsigned>(family);
+            InstanceGenerator generator(instanceSeed);
+            vector<int> cost = family == 0 ? generator.Euclidean(n)
+                : family == 1 ? generator.Clustered(n)
+                : generator.Asymmetric(n);
+
+            size_t first = rows.size();
+            int optimum = INF;
+            for (TSPMethod method : methods) {
+                if (method == TSPMethod::Exhaustive && n > 12) continue;
+                if (method == TSPMethod::HeldKarp && n > 22) continue;
+
+                SearchStats stats;
+                bool timedOut = false;
+                auto start = chrono::steady_clock::now();
+                auto result = SolveWithTimeLimit(cost, n, method, stats, timeLimitMs, timedOut);
+                double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+                // Оптимум - только от точного метода, завершившегося вовремя
+                if (method != TSPMethod::Heuristic && !timedOut) optimum = min(optimum, result.second);
+                BenchmarkRow row = { families[family], n, instanceSeed, TSPMethodKey(method),
+                    timedOut ? "timeout" : stats.budgetExceeded ? "memory" : "ok", result.second, INF, stats, ms };
+                rows.push_back(row);
+            }
+            for (size_t k = first; k < rows.size(); ++k) rows[k].optimum = optimum;
+        }
+    }
+
+    if (outputPath.empty()) {
+        WriteBenchmarkRows(cout, rows, json);
+    }
+    else {
+        ofstream out(outputPath);
+        WriteBenchmarkRows(out, rows, json);
+    }
+    return 0;
+}
+
 GraphVisualizer visualizer;
 
 void display() {
@@ -529,7 +4100,24 @@ void keyboard(unsigned char key, int x, int y) {
     visualizer.handleKeyboard(key, x, y);
 }
 
+void timer(int value) {
+    visualizer.update();
+    glutTimerFunc(50, timer, 0);
+}
+
 int main(int argc, char** argv) {
+    if (argc > 1 && string(argv[1]) == "--batch") {
+        return RunBatch(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        return RunBenchmark(argc, argv);
+    }
+
+    // Каталог для кэша решений между запусками: kommivoyajor --cache-dir <каталог>
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (string(argv[i]) == "--cache-dir") visualizer.setCacheDirectory(argv[i + 1]);
+    }
+
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
     glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -541,6 +4129,7 @@ int main(int argc, char** argv) {
     glutReshapeFunc(reshape);
     glutMouseFunc(mouse);
     glutKeyboardFunc(keyboard);
+    glutTimerFunc(50, timer, 0);
 
     glutMainLoop();
     return 0;